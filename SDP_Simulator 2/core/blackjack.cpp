@@ -0,0 +1,97 @@
+#include "blackjack.h"
+#include "shoe.h"
+#include "rules.h"
+#include "FEHRandom.h"
+
+/*
+ DealCard Function
+
+ This function generates a random card value between 2 and 10.
+ It uses FEHRandom to meet the random generation requirement for the project.
+ Every thread draws from its own FEHRandom stream, so it is safe to call from the simulator threads.
+
+ Input Arguments: None
+
+ Return Value: Integer card value (2-10, no aces or face cards)
+
+ Author: Akshit Jalli, Kerem Cakmak
+ Reference: FEHRandom library documentation
+ */
+int DealCard() {
+    // returns random card value between 2 and 10
+    return Random.RandRange(2, 10);
+}
+
+/*
+ DealCards Function
+
+ This function deals many cards at once into an array, with the same odds as DealCard.
+ It is much faster than calling DealCard in a loop when thousands of cards are needed.
+
+ Input Arguments:
+   - cards: Array to fill with card values
+   - count: Number of cards to deal
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+void DealCards(int *cards, int count) {
+    Random.Fill(cards, count, 2, 10);
+}
+
+
+int DetermineWinner(int playerValue, int dealerValue) {
+    // looked up in the table the compiler built for the game rules
+    return RoundEngine<StandardRules>::DetermineWinner(playerValue, dealerValue);
+}
+
+/*
+ PlayRound Function
+
+ This function plays one complete round without drawing anything, following the
+ same order as PlayBlackjack: two cards each, the player's turn, then the dealer's.
+ The player hits until their hand reaches playerStandValue. A player bust ends the
+ round right away, the dealer never plays, just like on screen.
+ Money is not changed here, use RoundPayout to apply the result.
+ The round itself is RoundEngine::PlayRound for the game rules (see rules.h).
+
+ Input Arguments:
+   - player: Player to deal to (reset at the start of the round)
+   - dealer: Dealer to deal to (reset at the start of the round)
+   - playerStandValue: Hand value at which the player stops hitting
+   - shoe: Shoe to deal from, or NULL to deal from the infinite deck with DealCard
+
+ Return Value: playerwin, playerloss or playertie
+
+ Author: Kerem Cakmak
+ */
+int PlayRound(Player *player, Dealer *dealer, int playerStandValue, Shoe *shoe) {
+    if(shoe == NULL) {
+        return RoundEngine<StandardRules>::PlayRound(player, dealer, playerStandValue, NULL);
+    }
+    return RoundEngine<StandardShoeRules>::PlayRound(player, dealer, playerStandValue, shoe);
+}
+
+/*
+ RoundPayout Function
+
+ This function converts a round result into the money won or lost,
+ using the same rewards as the game screen.
+
+ Input Arguments:
+   - result: playerwin, playerloss or playertie
+
+ Return Value: win_reward, -loss_penalty or 0
+
+ Author: Kerem Cakmak
+ */
+int RoundPayout(int result) {
+    if(result == playerwin) {
+        return win_reward;
+    }
+    if(result == playerloss) {
+        return -loss_penalty;
+    }
+    return 0;
+}
@@ -0,0 +1,271 @@
+#ifndef BLACKJACK_H
+#define BLACKJACK_H
+
+/*
+ Blackjack game core
+
+ Card, hand, and round logic shared by the LCD game in main.cpp and the headless
+ tools in tools/. Nothing in this directory may include FEHLCD, FEHImages or tigr,
+ so the simulator can be built without a window, X11 or OpenGL.
+ */
+
+#define playerwin 1
+#define playerloss -1
+#define playertie 0
+
+#define max_cards 11
+#define ace_card 1
+#define blackjack_value 21
+#define dealer_stand_value 17
+#define win_reward 100
+#define loss_penalty 50
+
+class Shoe;
+
+/*
+ Hand Class
+
+ This class manages a player's or dealer's hand of cards in blackjack.
+ It stores the cards, keeps track of how many cards are in the hand, and calculates the total hand value.
+ The total is kept up to date as cards are added, so GetValue() does not have to add the cards up again.
+ Everything is stored in bytes so a Hand is exactly 16 bytes, and large arrays of hands stay in cache.
+
+ Private Members:
+   - cards[max_cards]: Array that stores card values (2-10, or ace_card for an ace)
+   - count: Number of cards currently in the hand
+   - hardTotal: Sum of the cards with every ace counted as 1
+   - aces: Number of aces in the hand
+   - value: Best hand value (one ace counted as 11 if that does not bust)
+   - soft: 1 if value counts an ace as 11, 0 otherwise
+
+ Public Members:
+   - AddCard(int card): Adds a new card to the hand
+   - GetValue(): Returns the total value of all cards in the hand
+   - IsSoft(): Returns true if the value counts an ace as 11
+   - GetCount(): Returns how many cards are in the hand
+   - GetCard(int index): Returns the card at a specific index
+   - Clear(): Resets the hand to empty for a new round
+
+ Author: Akshit Jalli
+ */
+class Hand {
+private:
+    unsigned char cards[max_cards];
+    unsigned char count;
+    unsigned char hardTotal;
+    unsigned char aces;
+    unsigned char value;
+    unsigned char soft;
+
+public:
+    // constructor initializes empty hand
+    Hand() {
+        int i = 0;
+        while(i < max_cards) {
+            cards[i] = 0;
+            i = i + 1;
+        }
+        Clear();
+    }
+
+    // adds a card to the hand and updates the total
+    void AddCard(int card) {
+        if(count < max_cards) {
+            cards[count] = (unsigned char)card;
+            count = count + 1;
+            hardTotal = hardTotal + card;
+            if(card == ace_card) {
+                aces = aces + 1;
+            }
+
+            // one ace can count as 11 instead of 1 if that does not bust the hand
+            if(aces > 0 && hardTotal + 10 <= blackjack_value) {
+                value = hardTotal + 10;
+                soft = 1;
+            } else {
+                value = hardTotal;
+                soft = 0;
+            }
+        }
+    }
+
+    // returns total hand value
+    int GetValue() {
+        return value;
+    }
+
+    // returns true if an ace is being counted as 11
+    bool IsSoft() {
+        return soft == 1;
+    }
+
+    // returns number of cards in hand
+    int GetCount() {
+        return count;
+    }
+
+    // returns card at specified index
+    int GetCard(int index) {
+        if(index >= 0 && index < count) {
+            return cards[index];
+        }
+        return 0;
+    }
+
+    // clears the hand for new round
+    void Clear() {
+        count = 0;
+        hardTotal = 0;
+        aces = 0;
+        value = 0;
+        soft = 0;
+    }
+};
+
+static_assert(sizeof(Hand) == 16, "Hand should stay 16 bytes so batches of hands fit in cache");
+
+/*
+ Player Class
+
+ This class represents a human player in the blackjack game.
+ It manages the player's hand of cards, their money, and whether they've chosen to stand.
+
+ Private Members:
+   - hand: Hand object that stores the player's cards
+   - money: The player's current money amount
+   - hasStood: Whether the player has chosen to stand (stop taking cards)
+
+ Public Members:
+   - GetHand(): Returns a reference to the player's hand
+   - GetMoney(): Returns the player's current money
+   - AddMoney(int amount): Adds money to the player's total
+   - Stand(): Player chooses to stand and end their turn
+   - HasStood(): Returns true if the player has stood, false otherwise
+   - Reset(): Resets the player for a new round
+
+ Author: Akshit Jalli
+ */
+class Player {
+private:
+    Hand hand;
+    int money;
+    bool hasStood;
+
+public:
+    // constructor initializes player with starting money
+    Player(int startingMoney) {
+        money = startingMoney;
+        hasStood = false;
+    }
+
+    // returns pointer to player's hand
+    Hand* GetHand() {
+        return &hand;
+    }
+
+    // returns player's current money
+    int GetMoney() {
+        return money;
+    }
+
+    // sets player's money amount
+    void SetMoney(int amount) {
+        money = amount;
+        if(money < 0) {
+            money = 0;
+        }
+    }
+
+    // adds money to player's total
+    void AddMoney(int amount) {
+        money = money + amount;
+        if(money < 0) {
+            money = 0;
+        }
+    }
+
+    // player chooses to stand
+    void Stand() {
+        hasStood = true;
+    }
+
+    // checks if player has stood
+    bool HasStood() {
+        return hasStood;
+    }
+
+    // resets player for new round
+    void Reset() {
+        hand.Clear();
+        hasStood = false;
+    }
+};
+
+/*
+ Dealer Class
+
+ This class represents the dealer (AI opponent) in single-player blackjack.
+ It manages the dealer's hand and implements the dealer AI logic for playing.
+
+ Private Members:
+   - hand: Hand object that stores the dealer's cards
+   - hasStood: Whether the dealer has finished playing their turn
+
+ Public Members:
+   - GetHand(): Returns a reference to the dealer's hand
+   - Stand(): Dealer chooses to stand and end their turn
+   - HasStood(): Returns true if the dealer has stood, false otherwise
+   - ShouldHit(): Returns true if dealer should hit (follows Rule of 17: hit if 16 or less)
+   - Reset(): Resets the dealer for a new round
+
+ Author: Kerem Cakmak
+ */
+class Dealer {
+private:
+    Hand hand;
+    bool hasStood;
+
+public:
+    // constructor initializes dealer
+    Dealer() {
+        hasStood = false;
+    }
+
+    // returns pointer to dealer's hand
+    Hand* GetHand() {
+        return &hand;
+    }
+
+    // dealer chooses to stand
+    void Stand() {
+        hasStood = true;
+    }
+
+    // checks if dealer has stood
+    bool HasStood() {
+        return hasStood;
+    }
+
+    // dealer AI follows rule of 17
+    bool ShouldHit() {
+        int value = hand.GetValue();
+        if(value < dealer_stand_value) {
+            return true;
+        }
+        return false;
+    }
+
+    // resets dealer for new round
+    void Reset() {
+        hand.Clear();
+        hasStood = false;
+    }
+};
+
+int DealCard();
+void DealCards(int *cards, int count);
+int DetermineWinner(int playerValue, int dealerValue);
+int PlayRound(Player *player, Dealer *dealer, int playerStandValue, Shoe *shoe);
+int RoundPayout(int result);
+
+#endif // BLACKJACK_H
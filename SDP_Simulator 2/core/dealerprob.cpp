@@ -0,0 +1,256 @@
+#include "dealerprob.h"
+
+#include <stddef.h>
+
+#define dealer_cache_start 1024
+
+// packs counts[2..10] into one key, 7 bits per card value (each count must be at most dealer_key_max)
+unsigned long long PackComposition(const int *counts) {
+    unsigned long long key = 0;
+    int card = min_card;
+    while(card <= max_card) {
+        key = (key << dealer_key_bits) | (unsigned long long)counts[card];
+        card = card + 1;
+    }
+    return key;
+}
+
+// mixes the key and total into a table index (splitmix64 finalizer)
+static unsigned long long HashState(unsigned long long key, int total) {
+    unsigned long long h = key ^ ((unsigned long long)total * 0x9E3779B97F4A7C15ULL);
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+DealerCache::DealerCache() {
+    entries.resize(dealer_cache_start);
+    Clear();
+}
+
+// empties the table but keeps its memory
+void DealerCache::Clear() {
+    int i = 0;
+    while(i < (int)entries.size()) {
+        entries[i].key = 0;
+        i = i + 1;
+    }
+    used = 0;
+    hits = 0;
+    misses = 0;
+}
+
+/*
+ Find Function
+
+ This function looks up a (composition, total) state with linear probing.
+
+ Input Arguments:
+   - key: Packed composition (never 0, an empty shoe is not cached)
+   - total: Dealer total
+
+ Return Value: The entry, or NULL if the state has not been solved yet
+
+ Author: Kerem Cakmak
+ */
+const DealerCache::Entry *DealerCache::Find(unsigned long long key, int total) {
+    unsigned long long mask = entries.size() - 1;
+    unsigned long long i = HashState(key, total) & mask;
+    while(entries[i].key != 0) {
+        if(entries[i].key == key && entries[i].total == total) {
+            hits = hits + 1;
+            return &entries[i];
+        }
+        i = (i + 1) & mask;
+    }
+    misses = misses + 1;
+    return NULL;
+}
+
+// stores a solved state, doubling the table once it is half full
+void DealerCache::Insert(unsigned long long key, int total, const double *probs) {
+    if((used + 1) * 2 > (int)entries.size()) {
+        Grow();
+    }
+    unsigned long long mask = entries.size() - 1;
+    unsigned long long i = HashState(key, total) & mask;
+    while(entries[i].key != 0) {
+        i = (i + 1) & mask;
+    }
+    entries[i].key = key;
+    entries[i].total = total;
+    int outcome = 0;
+    while(outcome < dealer_outcomes) {
+        entries[i].probs[outcome] = probs[outcome];
+        outcome = outcome + 1;
+    }
+    used = used + 1;
+}
+
+// doubles the table and puts every entry back in
+void DealerCache::Grow() {
+    std::vector<Entry> old;
+    old.swap(entries);
+    entries.resize(old.size() * 2);
+    int i = 0;
+    while(i < (int)entries.size()) {
+        entries[i].key = 0;
+        i = i + 1;
+    }
+    used = 0;
+    i = 0;
+    while(i < (int)old.size()) {
+        if(old[i].key != 0) {
+            Insert(old[i].key, old[i].total, old[i].probs);
+        }
+        i = i + 1;
+    }
+}
+
+/*
+ Solve Function
+
+ This function works out the dealer outcome probabilities from a total by trying
+ every card that is left, weighted by how many of it are left. Each result is
+ stored, so a state is only ever solved once. If the shoe runs out, the game
+ reshuffles, which is close enough to the infinite deck to use its table.
+
+ Input Arguments:
+   - total: Dealer total so far
+   - counts: Cards left of each value, changed during the search but restored
+   - left: Sum of counts
+   - out: Array of dealer_outcomes probabilities to write
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+void DealerCache::Solve(int total, int *counts, int left, double *out) {
+    int outcome = 0;
+    while(outcome < dealer_outcomes) {
+        out[outcome] = 0.0;
+        outcome = outcome + 1;
+    }
+
+    if(total > blackjack_value) {
+        out[dealer_bust] = 1.0;
+        return;
+    }
+    if(total >= dealer_stand_value) {
+        out[total - dealer_stand_value] = 1.0;
+        return;
+    }
+    if(left <= 0) {
+        InfiniteDealerProbabilities(total, out);
+        return;
+    }
+
+    unsigned long long key = PackComposition(counts);
+    const Entry *entry = Find(key, total);
+    if(entry != NULL) {
+        outcome = 0;
+        while(outcome < dealer_outcomes) {
+            out[outcome] = entry->probs[outcome];
+            outcome = outcome + 1;
+        }
+        return;
+    }
+
+    double next[dealer_outcomes];
+    int card = min_card;
+    while(card <= max_card) {
+        if(counts[card] > 0) {
+            double p = (double)counts[card] / left;
+            counts[card] = counts[card] - 1;
+            Solve(total + card, counts, left - 1, next);
+            counts[card] = counts[card] + 1;
+
+            outcome = 0;
+            while(outcome < dealer_outcomes) {
+                out[outcome] = out[outcome] + p * next[outcome];
+                outcome = outcome + 1;
+            }
+        }
+        card = card + 1;
+    }
+
+    Insert(key, total, out);
+}
+
+/*
+ Compute Function
+
+ This function gives the exact probability of each final dealer outcome when the
+ dealer shows upcard and the hole card and every hit come from the given cards.
+
+ Input Arguments:
+   - upcard: Dealer's visible card (2-10)
+   - counts: Cards left of each value, counts[card] for card 2-10 (array of max_card + 1)
+   - out: Array of dealer_outcomes probabilities to write (17, 18, 19, 20, 21, bust)
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+void DealerCache::Compute(int upcard, const int *counts, double *out) {
+    int local[max_card + 1] = {0};
+    int left = 0;
+    bool fits = true;
+    int card = min_card;
+    while(card <= max_card) {
+        local[card] = counts[card];
+        if(local[card] < 0) {
+            local[card] = 0;
+        }
+        if(local[card] > dealer_key_max) {
+            fits = false;
+        }
+        left = left + local[card];
+        card = card + 1;
+    }
+
+    if(fits == false) {
+        InfiniteDealerProbabilities(upcard, out);
+        return;
+    }
+    Solve(upcard, local, left, out);
+}
+
+// same as above, for the cards still left in a shoe
+void DealerCache::Compute(int upcard, Shoe *shoe, double *out) {
+    int counts[max_card + 1] = {0};
+    int card = min_card;
+    while(card <= max_card) {
+        counts[card] = shoe->GetRemainingOfValue(card);
+        card = card + 1;
+    }
+    Compute(upcard, counts, out);
+}
+
+/*
+ InfiniteDealerProbabilities Function
+
+ This function copies the dealer outcome probabilities for the infinite deck
+ (DealCard) out of the compile-time table.
+
+ Input Arguments:
+   - upcard: Dealer's visible card, or any dealer total
+   - out: Array of dealer_outcomes probabilities to write
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+void InfiniteDealerProbabilities(int upcard, double *out) {
+    if(upcard < 0) {
+        upcard = 0;
+    }
+    if(upcard >= dealer_table_totals) {
+        upcard = dealer_table_totals - 1;
+    }
+    int outcome = 0;
+    while(outcome < dealer_outcomes) {
+        out[outcome] = dealer_infinite_table.probs[upcard][outcome];
+        outcome = outcome + 1;
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef DEALERPROB_H
+#define DEALERPROB_H
+
+#include <vector>
+
+#include "blackjack.h"
+#include "shoe.h"
+
+// final dealer outcomes: index 0-4 are totals 17-21, index 5 is a bust
+#define dealer_outcomes 6
+#define dealer_bust 5
+
+// bits per card value in a packed composition
+#define dealer_key_bits 7
+#define dealer_key_max ((1 << dealer_key_bits) - 1)
+
+// highest total a hand can reach before the next card is dealt, plus one
+#define dealer_table_totals (blackjack_value + max_card + 1)
+
+/*
+ DealerTable Struct
+
+ Probability of each final dealer outcome for every starting dealer total,
+ probs[total][outcome]. A dealer showing upcard u starts from total u, since the
+ hole card is drawn under the same rule as every other card.
+
+ Author: Kerem Cakmak
+ */
+struct DealerTable {
+    double probs[dealer_table_totals][dealer_outcomes];
+};
+
+/*
+ MakeInfiniteDealerTable Function
+
+ This function works out the exact dealer outcome probabilities for the infinite
+ 2-10 deck (every card 1/9), from the highest total down, so each total only needs
+ the totals above it. It is constexpr, so dealer_infinite_table below is computed
+ by the compiler and ships as a constant.
+
+ Input Arguments: None
+
+ Return Value: DealerTable for the infinite deck
+
+ Author: Kerem Cakmak
+ */
+constexpr DealerTable MakeInfiniteDealerTable() {
+    DealerTable table = {};
+    int total = dealer_table_totals - 1;
+    while(total >= 0) {
+        if(total > blackjack_value) {
+            table.probs[total][dealer_bust] = 1.0;
+        } else {
+            if(total >= dealer_stand_value) {
+                table.probs[total][total - dealer_stand_value] = 1.0;
+            } else {
+                int card = min_card;
+                while(card <= max_card) {
+                    int outcome = 0;
+                    while(outcome < dealer_outcomes) {
+                        table.probs[total][outcome] = table.probs[total][outcome] + table.probs[total + card][outcome] / (max_card - min_card + 1);
+                        outcome = outcome + 1;
+                    }
+                    card = card + 1;
+                }
+            }
+        }
+        total = total - 1;
+    }
+    return table;
+}
+
+constexpr DealerTable dealer_infinite_table = MakeInfiniteDealerTable();
+
+/*
+ DealerCache Class
+
+ This class works out the exact probability of each final dealer outcome for an
+ upcard and the cards left in a shoe. Dealer::ShouldHit is fixed (hit on 16 or less),
+ so the answer only depends on the dealer's total and the composition, and can be
+ computed by recursion instead of sampled. Every (total, composition) state that the
+ recursion visits is stored in a hashed transposition table, so repeating a query, or
+ asking about a composition that shares states with an earlier one, is mostly lookups.
+
+ The composition is packed into one 64-bit key, 7 bits per card value, so shoes with
+ up to 127 of each value (31 decks) are exact. Larger shoes use the infinite deck table.
+ A cache is not thread safe, give every thread its own.
+
+ Private Members:
+   - entries: Open addressing table, a power of two in size, key 0 means empty
+   - used: Number of entries in use
+   - hits, misses: Lookup counts since the last Clear()
+
+ Public Members:
+   - Compute(int upcard, const int *counts, double *out): Outcome probabilities for a
+     composition, counts[card] for card 2-10
+   - Compute(int upcard, Shoe *shoe, double *out): Same, for the cards left in a shoe
+   - Clear(): Empties the table
+   - GetSize(), GetHits(), GetMisses(): Table statistics
+
+ Author: Kerem Cakmak
+ */
+class DealerCache {
+private:
+    // one entry is 64 bytes, a single cache line
+    struct Entry {
+        unsigned long long key;
+        int total;
+        double probs[dealer_outcomes];
+    };
+
+    std::vector<Entry> entries;
+    int used;
+    long long hits;
+    long long misses;
+
+    const Entry *Find(unsigned long long key, int total);
+    void Insert(unsigned long long key, int total, const double *probs);
+    void Grow();
+    void Solve(int total, int *counts, int left, double *out);
+
+public:
+    DealerCache();
+
+    void Compute(int upcard, const int *counts, double *out);
+    void Compute(int upcard, Shoe *shoe, double *out);
+    void Clear();
+
+    int GetSize() { return used; }
+    long long GetHits() { return hits; }
+    long long GetMisses() { return misses; }
+};
+
+unsigned long long PackComposition(const int *counts);
+void InfiniteDealerProbabilities(int upcard, double *out);
+
+#endif // DEALERPROB_H
@@ -0,0 +1,359 @@
+#include "handbatch.h"
+#include "blackjack.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HANDBATCH_X86 1
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/*
+ HandBatch Constructor
+
+ This function makes a batch of empty hands, padded up to a whole number of
+ SIMD registers so the kernels never need a leftover loop.
+
+ Input Arguments:
+   - numHands: Number of hands in the batch
+
+ Author: Kerem Cakmak
+ */
+HandBatch::HandBatch(int numHands) {
+    if(numHands < 0) {
+        numHands = 0;
+    }
+    size = numHands;
+    lanes = ((numHands + batch_lane_multiple - 1) / batch_lane_multiple) * batch_lane_multiple;
+    totals.resize(lanes);
+    counts.resize(lanes);
+    stood.resize(lanes);
+    Clear();
+}
+
+// empties every hand, padding lanes are marked as stood so they never draw
+void HandBatch::Clear() {
+    int i = 0;
+    while(i < lanes) {
+        totals[i] = 0;
+        counts[i] = 0;
+        if(i < size) {
+            stood[i] = 0;
+        } else {
+            stood[i] = 1;
+        }
+        i = i + 1;
+    }
+}
+
+// adds cards[i] to hand i for every hand in the batch, used for the opening deal
+void HandBatch::AddCards(const unsigned char *cards) {
+    int i = 0;
+    while(i < size) {
+        totals[i] = totals[i] + cards[i];
+        counts[i] = counts[i] + 1;
+        i = i + 1;
+    }
+}
+
+// returns the best SIMD level this CPU supports
+static int DetectBatchSimdLevel() {
+    int level = simd_scalar;
+#ifdef HANDBATCH_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        level = simd_avx2;
+    } else {
+        if(__builtin_cpu_supports("sse2")) {
+            level = simd_sse2;
+        }
+    }
+#endif
+    return level;
+}
+
+/*
+ BatchSimdLevel Function
+
+ This function checks once which SIMD instructions this CPU has. The check runs in
+ a static initializer, so simulator threads calling this at the same time are safe.
+
+ Input Arguments: None
+
+ Return Value: simd_avx2, simd_sse2 or simd_scalar
+
+ Author: Kerem Cakmak
+ */
+int BatchSimdLevel() {
+    static const int level = DetectBatchSimdLevel();
+    return level;
+}
+
+// returns a printable name for a SIMD level
+const char *BatchSimdName(int level) {
+    if(level == simd_avx2) {
+        return "avx2";
+    }
+    if(level == simd_sse2) {
+        return "sse2";
+    }
+    return "scalar";
+}
+
+/*
+ PlayOutBatchScalar Function
+
+ This function is the plain C++ version of the play-out kernel and the reference
+ the SIMD versions must match. Every step, each hand that has not stood and is
+ below standValue takes one card; hand i's card for step k is cards[k * lanes + i].
+ A hand that does not take a card stands. With standValue 17 this is exactly
+ Dealer::ShouldHit() (hit on 16 or less), and a player who stands on a value uses
+ the same rule.
+
+ Input Arguments:
+   - batch: Hands to play out
+   - cards: maxSteps rows of GetLanes() cards
+   - maxSteps: Number of card rows available
+   - standValue: Value at which a hand stops taking cards
+
+ Return Value: Number of steps that were needed
+
+ Author: Kerem Cakmak
+ */
+static int PlayOutBatchScalar(HandBatch *batch, const unsigned char *cards, int maxSteps, int standValue) {
+    unsigned char *totals = batch->GetTotals();
+    unsigned char *counts = batch->GetCounts();
+    unsigned char *stood = batch->GetStood();
+    int lanes = batch->GetLanes();
+
+    int step = 0;
+    while(step < maxSteps) {
+        const unsigned char *row = cards + (long)step * lanes;
+        int anyHit = 0;
+        int i = 0;
+        while(i < lanes) {
+            if(stood[i] == 0 && totals[i] < standValue && counts[i] < max_cards) {
+                totals[i] = totals[i] + row[i];
+                counts[i] = counts[i] + 1;
+                anyHit = 1;
+            } else {
+                stood[i] = 1;
+            }
+            i = i + 1;
+        }
+        if(anyHit == 0) {
+            return step;
+        }
+        step = step + 1;
+    }
+    return step;
+}
+
+#ifdef HANDBATCH_X86
+// SSE2 version of PlayOutBatchScalar, 16 hands per instruction
+TARGET_SSE2 static int PlayOutBatchSse2(HandBatch *batch, const unsigned char *cards, int maxSteps, int standValue) {
+    unsigned char *totals = batch->GetTotals();
+    unsigned char *counts = batch->GetCounts();
+    unsigned char *stood = batch->GetStood();
+    int lanes = batch->GetLanes();
+
+    __m128i stand = _mm_set1_epi8((char)standValue);
+    __m128i maxCount = _mm_set1_epi8(max_cards);
+    __m128i one = _mm_set1_epi8(1);
+    __m128i zero = _mm_setzero_si128();
+
+    int step = 0;
+    while(step < maxSteps) {
+        const unsigned char *row = cards + (long)step * lanes;
+        __m128i anyHit = zero;
+        int i = 0;
+        while(i < lanes) {
+            __m128i t = _mm_loadu_si128((const __m128i *)(totals + i));
+            __m128i c = _mm_loadu_si128((const __m128i *)(counts + i));
+            __m128i s = _mm_loadu_si128((const __m128i *)(stood + i));
+            __m128i card = _mm_loadu_si128((const __m128i *)(row + i));
+
+            // hit = not stood and total < stand and count < max_cards
+            __m128i hit = _mm_and_si128(_mm_cmplt_epi8(t, stand), _mm_cmplt_epi8(c, maxCount));
+            hit = _mm_and_si128(hit, _mm_cmpeq_epi8(s, zero));
+
+            t = _mm_add_epi8(t, _mm_and_si128(card, hit));
+            c = _mm_add_epi8(c, _mm_and_si128(one, hit));
+            s = _mm_andnot_si128(hit, one);
+
+            _mm_storeu_si128((__m128i *)(totals + i), t);
+            _mm_storeu_si128((__m128i *)(counts + i), c);
+            _mm_storeu_si128((__m128i *)(stood + i), s);
+            anyHit = _mm_or_si128(anyHit, hit);
+            i = i + 16;
+        }
+        if(_mm_movemask_epi8(anyHit) == 0) {
+            return step;
+        }
+        step = step + 1;
+    }
+    return step;
+}
+
+// AVX2 version of PlayOutBatchScalar, 32 hands per instruction
+TARGET_AVX2 static int PlayOutBatchAvx2(HandBatch *batch, const unsigned char *cards, int maxSteps, int standValue) {
+    unsigned char *totals = batch->GetTotals();
+    unsigned char *counts = batch->GetCounts();
+    unsigned char *stood = batch->GetStood();
+    int lanes = batch->GetLanes();
+
+    __m256i stand = _mm256_set1_epi8((char)standValue);
+    __m256i maxCount = _mm256_set1_epi8(max_cards);
+    __m256i one = _mm256_set1_epi8(1);
+    __m256i zero = _mm256_setzero_si256();
+
+    int step = 0;
+    while(step < maxSteps) {
+        const unsigned char *row = cards + (long)step * lanes;
+        __m256i anyHit = zero;
+        int i = 0;
+        while(i < lanes) {
+            __m256i t = _mm256_loadu_si256((const __m256i *)(totals + i));
+            __m256i c = _mm256_loadu_si256((const __m256i *)(counts + i));
+            __m256i s = _mm256_loadu_si256((const __m256i *)(stood + i));
+            __m256i card = _mm256_loadu_si256((const __m256i *)(row + i));
+
+            // hit = not stood and total < stand and count < max_cards
+            __m256i hit = _mm256_and_si256(_mm256_cmpgt_epi8(stand, t), _mm256_cmpgt_epi8(maxCount, c));
+            hit = _mm256_and_si256(hit, _mm256_cmpeq_epi8(s, zero));
+
+            t = _mm256_add_epi8(t, _mm256_and_si256(card, hit));
+            c = _mm256_add_epi8(c, _mm256_and_si256(one, hit));
+            s = _mm256_andnot_si256(hit, one);
+
+            _mm256_storeu_si256((__m256i *)(totals + i), t);
+            _mm256_storeu_si256((__m256i *)(counts + i), c);
+            _mm256_storeu_si256((__m256i *)(stood + i), s);
+            anyHit = _mm256_or_si256(anyHit, hit);
+            i = i + 32;
+        }
+        if(_mm256_movemask_epi8(anyHit) == 0) {
+            return step;
+        }
+        step = step + 1;
+    }
+    return step;
+}
+#endif
+
+/*
+ PlayOutBatch Function
+
+ This function plays out every hand in a batch (see PlayOutBatchScalar) using the
+ given SIMD level. All levels give bit-identical results for the same cards.
+
+ Input Arguments:
+   - batch: Hands to play out
+   - cards: maxSteps rows of GetLanes() cards
+   - maxSteps: Number of card rows available
+   - standValue: Value at which a hand stops taking cards (17 for the dealer)
+   - level: simd_scalar, simd_sse2 or simd_avx2 (must be supported by the CPU)
+
+ Return Value: Number of steps that were needed
+
+ Author: Kerem Cakmak
+ */
+int PlayOutBatch(HandBatch *batch, const unsigned char *cards, int maxSteps, int standValue, int level) {
+#ifdef HANDBATCH_X86
+    if(level == simd_avx2) {
+        return PlayOutBatchAvx2(batch, cards, maxSteps, standValue);
+    }
+    if(level == simd_sse2) {
+        return PlayOutBatchSse2(batch, cards, maxSteps, standValue);
+    }
+#endif
+    return PlayOutBatchScalar(batch, cards, maxSteps, standValue);
+}
+
+// plays out a batch with the best SIMD level this CPU has
+int PlayOutBatch(HandBatch *batch, const unsigned char *cards, int maxSteps, int standValue) {
+    return PlayOutBatch(batch, cards, maxSteps, standValue, BatchSimdLevel());
+}
+
+#ifdef HANDBATCH_X86
+// SSE2 version of DetermineWinner for 16 hands at a time
+TARGET_SSE2 static void DetermineWinnerBatchSse2(const unsigned char *playerTotals, const unsigned char *dealerTotals, signed char *results, int lanes) {
+    __m128i bust = _mm_set1_epi8(blackjack_value);
+    __m128i one = _mm_set1_epi8(1);
+    int i = 0;
+    while(i < lanes) {
+        __m128i p = _mm_loadu_si128((const __m128i *)(playerTotals + i));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dealerTotals + i));
+        __m128i playerBust = _mm_cmpgt_epi8(p, bust);
+        __m128i dealerBust = _mm_cmpgt_epi8(d, bust);
+
+        // win: player did not bust, and the dealer busted or is lower
+        __m128i win = _mm_andnot_si128(playerBust, _mm_or_si128(dealerBust, _mm_cmpgt_epi8(p, d)));
+        // loss: player busted, or the dealer did not bust and is higher
+        __m128i loss = _mm_or_si128(playerBust, _mm_andnot_si128(dealerBust, _mm_cmpgt_epi8(d, p)));
+
+        // loss lanes are all ones (-1), win lanes are 1, ties stay 0
+        __m128i result = _mm_or_si128(loss, _mm_and_si128(win, one));
+        _mm_storeu_si128((__m128i *)(results + i), result);
+        i = i + 16;
+    }
+}
+
+// AVX2 version of DetermineWinner for 32 hands at a time
+TARGET_AVX2 static void DetermineWinnerBatchAvx2(const unsigned char *playerTotals, const unsigned char *dealerTotals, signed char *results, int lanes) {
+    __m256i bust = _mm256_set1_epi8(blackjack_value);
+    __m256i one = _mm256_set1_epi8(1);
+    int i = 0;
+    while(i < lanes) {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(playerTotals + i));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dealerTotals + i));
+        __m256i playerBust = _mm256_cmpgt_epi8(p, bust);
+        __m256i dealerBust = _mm256_cmpgt_epi8(d, bust);
+
+        __m256i win = _mm256_andnot_si256(playerBust, _mm256_or_si256(dealerBust, _mm256_cmpgt_epi8(p, d)));
+        __m256i loss = _mm256_or_si256(playerBust, _mm256_andnot_si256(dealerBust, _mm256_cmpgt_epi8(d, p)));
+
+        __m256i result = _mm256_or_si256(loss, _mm256_and_si256(win, one));
+        _mm256_storeu_si256((__m256i *)(results + i), result);
+        i = i + 32;
+    }
+}
+#endif
+
+/*
+ DetermineWinnerBatch Function
+
+ This function runs DetermineWinner for every lane of two total arrays.
+
+ Input Arguments:
+   - playerTotals, dealerTotals: Hand totals, one byte per lane (below 128)
+   - results: Receives playerwin, playerloss or playertie for every lane
+   - lanes: Number of lanes, a multiple of batch_lane_multiple
+   - level: simd_scalar, simd_sse2 or simd_avx2 (must be supported by the CPU)
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+void DetermineWinnerBatch(const unsigned char *playerTotals, const unsigned char *dealerTotals, signed char *results, int lanes, int level) {
+#ifdef HANDBATCH_X86
+    if(level == simd_avx2) {
+        DetermineWinnerBatchAvx2(playerTotals, dealerTotals, results, lanes);
+        return;
+    }
+    if(level == simd_sse2) {
+        DetermineWinnerBatchSse2(playerTotals, dealerTotals, results, lanes);
+        return;
+    }
+#endif
+    int i = 0;
+    while(i < lanes) {
+        results[i] = (signed char)DetermineWinner(playerTotals[i], dealerTotals[i]);
+        i = i + 1;
+    }
+}
+
+// runs DetermineWinner for every lane with the best SIMD level this CPU has
+void DetermineWinnerBatch(const unsigned char *playerTotals, const unsigned char *dealerTotals, signed char *results, int lanes) {
+    DetermineWinnerBatch(playerTotals, dealerTotals, results, lanes, BatchSimdLevel());
+}
@@ -0,0 +1,63 @@
+#ifndef HANDBATCH_H
+#define HANDBATCH_H
+
+#include <vector>
+
+#define batch_lane_multiple 32
+
+#define simd_scalar 0
+#define simd_sse2 1
+#define simd_avx2 2
+
+/*
+ HandBatch Class
+
+ This class stores many hands in structure-of-arrays form: all totals in one
+ array, all card counts in another, and all stood flags in a third, one byte per
+ hand ("lane"). That lets the SIMD kernels below work on 16 (SSE2) or 32 (AVX2)
+ hands per instruction. Only hard totals are kept, so it is meant for the 2-10 game
+ without aces. Totals must stay below 128.
+
+ Private Members:
+   - totals, counts, stood: One byte per lane
+   - size: Number of hands in use
+   - lanes: size rounded up to batch_lane_multiple, the padding lanes are always stood
+
+ Public Members:
+   - Clear(): Empties every hand
+   - AddCards(const unsigned char *cards): Adds cards[i] to hand i, for every hand
+   - GetTotals(), GetCounts(), GetStood(): Lane arrays
+   - GetSize(), GetLanes(): Number of hands and padded number of lanes
+
+ Author: Kerem Cakmak
+ */
+class HandBatch {
+private:
+    std::vector<unsigned char> totals;
+    std::vector<unsigned char> counts;
+    std::vector<unsigned char> stood;
+    int size;
+    int lanes;
+
+public:
+    HandBatch(int numHands);
+
+    void Clear();
+    void AddCards(const unsigned char *cards);
+
+    unsigned char *GetTotals() { return totals.data(); }
+    unsigned char *GetCounts() { return counts.data(); }
+    unsigned char *GetStood() { return stood.data(); }
+    int GetSize() { return size; }
+    int GetLanes() { return lanes; }
+};
+
+int BatchSimdLevel();
+const char *BatchSimdName(int level);
+
+int PlayOutBatch(HandBatch *batch, const unsigned char *cards, int maxSteps, int standValue, int level);
+int PlayOutBatch(HandBatch *batch, const unsigned char *cards, int maxSteps, int standValue);
+void DetermineWinnerBatch(const unsigned char *playerTotals, const unsigned char *dealerTotals, signed char *results, int lanes, int level);
+void DetermineWinnerBatch(const unsigned char *playerTotals, const unsigned char *dealerTotals, signed char *results, int lanes);
+
+#endif // HANDBATCH_H
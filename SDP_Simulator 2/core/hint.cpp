@@ -0,0 +1,128 @@
+#include "hint.h"
+#include "shoe.h"
+
+HintEngine::HintEngine() {
+    valid = false;
+    cachedValue = 0;
+    cachedCount = 0;
+    cachedUpcard = 0;
+    cachedRemaining = 0;
+    hitEV = 0.0;
+    standEV = 0.0;
+}
+
+// forgets the cached answer and the solver's states from the last round
+void HintEngine::NewRound() {
+    valid = false;
+    solver.Clear();
+}
+
+/*
+ Update Function
+
+ This function brings the Hit and Stand EVs up to date for the current hand.
+ It returns right away if nothing changed since the last call. The player has
+ not seen the dealer's hole card, so it is put back with the cards left in the
+ shoe; the hint only uses what is on screen.
+
+ Input Arguments:
+   - hand: Player's hand
+   - upcard: Dealer's visible card
+   - holeCard: Dealer's face down card (only used with a shoe)
+   - shoe: Shoe the round is dealt from, or NULL for the infinite deck
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+void HintEngine::Update(Hand *hand, int upcard, int holeCard, Shoe *shoe) {
+    int value = hand->GetValue();
+    int count = hand->GetCount();
+    int remaining = 0;
+    if(shoe != NULL) {
+        remaining = shoe->GetRemaining();
+    }
+
+    if(valid == true && value == cachedValue && count == cachedCount && upcard == cachedUpcard && remaining == cachedRemaining) {
+        return;
+    }
+
+    if(shoe == NULL) {
+        hitEV = solver.HitEV(value, count, upcard, NULL);
+        standEV = solver.StandEV(value, upcard, NULL);
+    } else {
+        int counts[max_card + 1] = {0};
+        int card = min_card;
+        while(card <= max_card) {
+            counts[card] = shoe->GetRemainingOfValue(card);
+            card = card + 1;
+        }
+        if(holeCard >= min_card && holeCard <= max_card) {
+            counts[holeCard] = counts[holeCard] + 1;
+        }
+        hitEV = ShoeHitEV(value, count, upcard, counts);
+        standEV = solver.StandEV(value, upcard, counts);
+    }
+
+    cachedValue = value;
+    cachedCount = count;
+    cachedUpcard = upcard;
+    cachedRemaining = remaining;
+    valid = true;
+}
+
+/*
+ ShoeHitEV Function
+
+ This function gives the EV of hitting once with a shoe. Every card that can come
+ next is weighted by how many of it are left, standing after it uses the exact dealer
+ odds for what is left, and hitting again after it uses the infinite deck table.
+
+ Input Arguments:
+   - total, count: Player's hand value and number of cards
+   - upcard: Dealer's visible card
+   - counts: Cards the player could be dealt, changed during the search but restored
+
+ Return Value: Expected money for the round
+
+ Author: Kerem Cakmak
+ */
+double HintEngine::ShoeHitEV(int total, int count, int upcard, int *counts) {
+    if(count >= max_cards) {
+        return -loss_penalty;
+    }
+    int left = 0;
+    int card = min_card;
+    while(card <= max_card) {
+        left = left + counts[card];
+        card = card + 1;
+    }
+    if(left <= 0) {
+        return solver.HitEV(total, count, upcard, NULL);
+    }
+
+    double ev = 0.0;
+    card = min_card;
+    while(card <= max_card) {
+        if(counts[card] > 0) {
+            double p = (double)counts[card] / left;
+            int next = total + card;
+            if(next > blackjack_value) {
+                ev = ev - p * loss_penalty;
+            } else {
+                counts[card] = counts[card] - 1;
+                double best = solver.StandEV(next, upcard, counts);
+                counts[card] = counts[card] + 1;
+                if(count + 1 < max_cards) {
+                    double hit = solver.HitEV(next, count + 1, upcard, NULL);
+                    if(hit > best) {
+                        best = hit;
+                    }
+                }
+                ev = ev + p * best;
+            }
+        }
+        card = card + 1;
+    }
+    return ev;
+}
@@ -0,0 +1,68 @@
+#ifndef HINT_H
+#define HINT_H
+
+#include "blackjack.h"
+#include "strategy.h"
+
+class Shoe;
+
+/*
+ HintEngine Class
+
+ This class gives the EV of Hit and Stand for the hand on screen, so the game can
+ show a hint during the player's turn without stalling a frame. The answer is cached
+ until the hand, the dealer's upcard or the shoe changes, so redrawing the same frame
+ costs nothing.
+
+ With the infinite deck both EVs are exact lookups in the solver's memoized table.
+ With a shoe, Stand and the card a hit would draw use the exact cards left, and any
+ later hits use the infinite deck table. A full search of every composition takes
+ milliseconds for low totals, this takes about ten dealer queries, and the dealer
+ cache is kept for the whole round so a query after a hit is mostly lookups.
+
+ Private Members:
+   - solver: EV solver, its memory is kept for the whole round
+   - valid: True if the cached answer below is up to date
+   - cachedValue, cachedCount, cachedUpcard, cachedRemaining: What the cached answer was worked out for
+   - hitEV, standEV: Cached answer
+
+ Public Members:
+   - NewRound(): Forgets the last round, call after the opening deal
+   - Update(Hand *hand, int upcard, int holeCard, Shoe *shoe): Brings the answer up to date
+   - GetHitEV(), GetStandEV(): Expected money for each choice
+   - GetAction(): action_hit or action_stand, whichever is better
+
+ Author: Kerem Cakmak
+ */
+class HintEngine {
+private:
+    EVSolver solver;
+    bool valid;
+    int cachedValue;
+    int cachedCount;
+    int cachedUpcard;
+    int cachedRemaining;
+    double hitEV;
+    double standEV;
+
+    double ShoeHitEV(int total, int count, int upcard, int *counts);
+
+public:
+    HintEngine();
+
+    void NewRound();
+    void Update(Hand *hand, int upcard, int holeCard, Shoe *shoe);
+
+    double GetHitEV() { return hitEV; }
+    double GetStandEV() { return standEV; }
+
+    // returns action_hit if hitting has the higher EV
+    int GetAction() {
+        if(hitEV > standEV) {
+            return action_hit;
+        }
+        return action_stand;
+    }
+};
+
+#endif // HINT_H
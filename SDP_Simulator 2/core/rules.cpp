@@ -0,0 +1,105 @@
+#include "rules.h"
+
+/*
+ RuleVariant Struct
+
+ One compiled rule set: its rules as run time values and its engine.
+
+ Members:
+   - rules: The RuleSet arguments
+   - play: RoundEngine<RuleSet<...> >::PlayRounds
+
+ Author: Kerem Cakmak
+ */
+struct RuleVariant {
+    RuleConfig rules;
+    RoundsFunction play;
+};
+
+// one table entry, the same arguments fill in the RuleConfig and instantiate the engine
+#define RULE_VARIANT(stand, bust, win, loss, low, high, decks) \
+    { { stand, bust, win, loss, low, high, decks }, &RoundEngine<RuleSet<stand, bust, win, loss, low, high, decks> >::PlayRounds }
+
+// Every rule set the tools can run. Add a line here to support another one.
+static const RuleVariant rule_variants[] = {
+    // game rules, infinite deck and the usual shoe sizes
+    RULE_VARIANT(dealer_stand_value, blackjack_value, win_reward, loss_penalty, min_card, max_card, 0),
+    RULE_VARIANT(dealer_stand_value, blackjack_value, win_reward, loss_penalty, min_card, max_card, 1),
+    RULE_VARIANT(dealer_stand_value, blackjack_value, win_reward, loss_penalty, min_card, max_card, 2),
+    RULE_VARIANT(dealer_stand_value, blackjack_value, win_reward, loss_penalty, min_card, max_card, 4),
+    RULE_VARIANT(dealer_stand_value, blackjack_value, win_reward, loss_penalty, min_card, max_card, 6),
+    RULE_VARIANT(dealer_stand_value, blackjack_value, win_reward, loss_penalty, min_card, max_card, 8),
+
+    // dealer stands on 16 or 18
+    RULE_VARIANT(16, blackjack_value, win_reward, loss_penalty, min_card, max_card, 0),
+    RULE_VARIANT(16, blackjack_value, win_reward, loss_penalty, min_card, max_card, 6),
+    RULE_VARIANT(18, blackjack_value, win_reward, loss_penalty, min_card, max_card, 0),
+    RULE_VARIANT(18, blackjack_value, win_reward, loss_penalty, min_card, max_card, 6),
+
+    // even money
+    RULE_VARIANT(dealer_stand_value, blackjack_value, win_reward, win_reward, min_card, max_card, 0),
+    RULE_VARIANT(dealer_stand_value, blackjack_value, win_reward, win_reward, min_card, max_card, 6),
+
+    // aces dealt too (infinite deck only, a Shoe holds 2-10)
+    RULE_VARIANT(dealer_stand_value, blackjack_value, win_reward, loss_penalty, ace_card, max_card, 0),
+    RULE_VARIANT(dealer_stand_value, blackjack_value, win_reward, win_reward, ace_card, max_card, 0)
+};
+
+#define rule_variant_count ((int)(sizeof(rule_variants) / sizeof(rule_variants[0])))
+
+// returns the rules the game screen uses, with the infinite deck
+RuleConfig StandardRuleConfig() {
+    RuleConfig rules;
+    rules.dealerStand = StandardRules::dealerStand;
+    rules.bustLimit = StandardRules::bustLimit;
+    rules.winReward = StandardRules::winReward;
+    rules.lossPenalty = StandardRules::lossPenalty;
+    rules.minCard = StandardRules::minCard;
+    rules.maxCard = StandardRules::maxCard;
+    rules.decks = StandardRules::decks;
+    return rules;
+}
+
+// returns true if every rule matches
+bool SameRules(RuleConfig a, RuleConfig b) {
+    return a.dealerStand == b.dealerStand && a.bustLimit == b.bustLimit
+        && a.winReward == b.winReward && a.lossPenalty == b.lossPenalty
+        && a.minCard == b.minCard && a.maxCard == b.maxCard && a.decks == b.decks;
+}
+
+/*
+ FindRuleVariant Function
+
+ This function finds the compiled engine for a set of rules. Call it once per run
+ and keep the result, then every round runs without checking the rules again.
+
+ Input Arguments:
+   - rules: Rules to look for
+
+ Return Value: The engine's PlayRounds function, or NULL if these rules were not compiled
+
+ Author: Kerem Cakmak
+ */
+RoundsFunction FindRuleVariant(RuleConfig rules) {
+    int i = 0;
+    while(i < rule_variant_count) {
+        if(SameRules(rule_variants[i].rules, rules) == true) {
+            return rule_variants[i].play;
+        }
+        i = i + 1;
+    }
+    return NULL;
+}
+
+// returns the number of compiled rule sets
+int RuleVariantCount() {
+    return rule_variant_count;
+}
+
+// returns the rules of one compiled rule set
+RuleConfig RuleVariantAt(int index) {
+    if(index < 0 || index >= rule_variant_count) {
+        return StandardRuleConfig();
+    }
+    return rule_variants[index].rules;
+}
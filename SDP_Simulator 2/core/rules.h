@@ -0,0 +1,311 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stddef.h>
+
+#include "blackjack.h"
+#include "shoe.h"
+#include "FEHRandom.h"
+
+/*
+ RuleSet Template
+
+ One set of blackjack rules, fixed at compile time. RoundEngine is instantiated once
+ per rule set, so every rule is a constant the compiler folds into the comparisons
+ and tables instead of a variable that is checked on every hand.
+
+ Template Arguments:
+   - DealerStand: Dealer stands on this value or more (dealer_stand_value)
+   - BustLimit: Highest value that does not bust (blackjack_value)
+   - WinReward, LossPenalty: Money won or lost per round (win_reward, loss_penalty)
+   - MinCard, MaxCard: Card values dealt, MinCard of ace_card deals aces
+   - Decks: 0 deals from the infinite deck, otherwise from a shoe of this many decks
+
+ Author: Kerem Cakmak
+ */
+template<int DealerStand, int BustLimit, int WinReward, int LossPenalty, int MinCard, int MaxCard, int Decks>
+struct RuleSet {
+    static constexpr int dealerStand = DealerStand;
+    static constexpr int bustLimit = BustLimit;
+    static constexpr int winReward = WinReward;
+    static constexpr int lossPenalty = LossPenalty;
+    static constexpr int minCard = MinCard;
+    static constexpr int maxCard = MaxCard;
+    static constexpr int decks = Decks;
+
+    static_assert(MinCard >= ace_card && MinCard <= MaxCard, "card range must be ace_card or more, low to high");
+    static_assert(DealerStand <= BustLimit, "dealer must be able to stand without busting");
+    static_assert(MinCard > ace_card || BustLimit == blackjack_value, "Hand counts an ace as 11 up to blackjack_value only");
+    static_assert(Decks == 0 || (MinCard == min_card && MaxCard == max_card), "a Shoe only holds cards min_card to max_card");
+};
+
+// the rules used by the game screen
+typedef RuleSet<dealer_stand_value, blackjack_value, win_reward, loss_penalty, min_card, max_card, 0> StandardRules;
+typedef RuleSet<dealer_stand_value, blackjack_value, win_reward, loss_penalty, min_card, max_card, 6> StandardShoeRules;
+
+/*
+ OutcomeTable Struct
+
+ Result of every (player value, dealer value) pair, result[player][dealer], for values
+ 0 to BustLimit plus one slot (BustLimit + 1) that every bust value is clamped to.
+
+ Author: Kerem Cakmak
+ */
+template<int BustLimit>
+struct OutcomeTable {
+    signed char result[BustLimit + 2][BustLimit + 2];
+};
+
+/*
+ MakeOutcomeTable Function
+
+ This function fills in an OutcomeTable at compile time with the same rules as
+ DetermineWinner: a player bust loses, then a dealer bust wins, then the higher value wins.
+
+ Input Arguments: None
+
+ Return Value: OutcomeTable for BustLimit
+
+ Author: Kerem Cakmak
+ */
+template<int BustLimit>
+constexpr OutcomeTable<BustLimit> MakeOutcomeTable() {
+    OutcomeTable<BustLimit> table = {};
+    int player = 0;
+    while(player <= BustLimit + 1) {
+        int dealer = 0;
+        while(dealer <= BustLimit + 1) {
+            signed char result = playertie;
+            if(player > BustLimit) {
+                result = playerloss;
+            } else {
+                if(dealer > BustLimit || player > dealer) {
+                    result = playerwin;
+                } else {
+                    if(dealer > player) {
+                        result = playerloss;
+                    }
+                }
+            }
+            table.result[player][dealer] = result;
+            dealer = dealer + 1;
+        }
+        player = player + 1;
+    }
+    return table;
+}
+
+/*
+ RuleTables Struct
+
+ Lookup tables for one rule set, built by the compiler.
+
+ Members:
+   - outcomes: Result of every player and dealer value pair
+   - payouts: Money for each result, payouts[result + 1]
+
+ Author: Kerem Cakmak
+ */
+template<class Rules>
+struct RuleTables {
+    static constexpr OutcomeTable<Rules::bustLimit> outcomes = MakeOutcomeTable<Rules::bustLimit>();
+    static constexpr int payouts[3] = { -Rules::lossPenalty, 0, Rules::winReward };
+};
+
+template<class Rules>
+constexpr OutcomeTable<Rules::bustLimit> RuleTables<Rules>::outcomes;
+template<class Rules>
+constexpr int RuleTables<Rules>::payouts[3];
+
+/*
+ RoundCounts Struct
+
+ Results of a run of rounds.
+
+ Members:
+   - wins, losses, ties: Round counts
+
+ Author: Kerem Cakmak
+ */
+struct RoundCounts {
+    long long wins;
+    long long losses;
+    long long ties;
+};
+
+/*
+ RoundEngine Class
+
+ The round logic of PlayRound, for one RuleSet. Every function is static and every
+ rule is a compile time constant, so each instantiation is its own specialized engine.
+
+ Public Members:
+   - Draw(Shoe *shoe): Deals one card, from the shoe only if the rules have decks
+   - DealerShouldHit(Hand *hand): Dealer's rule
+   - DetermineWinner(int playerValue, int dealerValue): Table lookup
+   - Payout(int result): Money for a result
+   - PlayRound(Player *player, Dealer *dealer, int playerStandValue, Shoe *shoe): One round
+   - PlayRounds(long long rounds, int playerStandValue, Shoe *shoe, RoundCounts *counts): Many rounds
+
+ Author: Kerem Cakmak
+ */
+template<class Rules>
+class RoundEngine {
+public:
+    // deals one card, the infinite deck or the shoe is picked at compile time
+    static int Draw(Shoe *shoe) {
+        if(Rules::decks > 0) {
+            return shoe->Draw();
+        }
+        return Random.RandRange(Rules::minCard, Rules::maxCard);
+    }
+
+    // dealer hits below the stand value
+    static bool DealerShouldHit(Hand *hand) {
+        return hand->GetValue() < Rules::dealerStand;
+    }
+
+    // returns playerwin, playerloss or playertie, bust values share the last row and column
+    static int DetermineWinner(int playerValue, int dealerValue) {
+        if(playerValue > Rules::bustLimit + 1) {
+            playerValue = Rules::bustLimit + 1;
+        }
+        if(dealerValue > Rules::bustLimit + 1) {
+            dealerValue = Rules::bustLimit + 1;
+        }
+        return RuleTables<Rules>::outcomes.result[playerValue][dealerValue];
+    }
+
+    // returns the money for a result
+    static int Payout(int result) {
+        return RuleTables<Rules>::payouts[result + 1];
+    }
+
+    static int PlayRound(Player *player, Dealer *dealer, int playerStandValue, Shoe *shoe);
+    static void PlayRounds(long long rounds, int playerStandValue, Shoe *shoe, RoundCounts *counts);
+};
+
+/*
+ PlayRound Function
+
+ This function plays one round in the same order as PlayBlackjack: two cards each,
+ the player's turn, then the dealer's. The player hits until their hand reaches
+ playerStandValue, and a player bust ends the round right away.
+
+ Input Arguments:
+   - player: Player to deal to (reset at the start of the round)
+   - dealer: Dealer to deal to (reset at the start of the round)
+   - playerStandValue: Hand value at which the player stops hitting
+   - shoe: Shoe to deal from (only used if the rules have decks)
+
+ Return Value: playerwin, playerloss or playertie
+
+ Author: Kerem Cakmak
+ */
+template<class Rules>
+int RoundEngine<Rules>::PlayRound(Player *player, Dealer *dealer, int playerStandValue, Shoe *shoe) {
+    player->Reset();
+    dealer->Reset();
+    if(Rules::decks > 0) {
+        shoe->StartRound();
+    }
+
+    // deal initial cards to player and dealer
+    player->GetHand()->AddCard(Draw(shoe));
+    player->GetHand()->AddCard(Draw(shoe));
+
+    dealer->GetHand()->AddCard(Draw(shoe));
+    dealer->GetHand()->AddCard(Draw(shoe));
+
+    // player turn
+    while(player->HasStood() == false) {
+        int playerValue = player->GetHand()->GetValue();
+        if(playerValue > Rules::bustLimit) {
+            return playerloss;
+        }
+        if(playerValue < playerStandValue && player->GetHand()->GetCount() < max_cards) {
+            player->GetHand()->AddCard(Draw(shoe));
+        } else {
+            player->Stand();
+        }
+    }
+
+    // dealer turn
+    while(dealer->HasStood() == false) {
+        if(DealerShouldHit(dealer->GetHand()) == true && dealer->GetHand()->GetCount() < max_cards) {
+            dealer->GetHand()->AddCard(Draw(shoe));
+        } else {
+            dealer->Stand();
+        }
+    }
+
+    return DetermineWinner(player->GetHand()->GetValue(), dealer->GetHand()->GetValue());
+}
+
+/*
+ PlayRounds Function
+
+ This function plays many rounds and adds their results to counts. The simulator
+ looks this function up once per run with FindRuleVariant, so the rules are never
+ checked per hand.
+
+ Input Arguments:
+   - rounds: Number of rounds to play
+   - playerStandValue: Hand value at which the player stops hitting
+   - shoe: Shoe to deal from (only used if the rules have decks)
+   - counts: Counts to add the results to
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+template<class Rules>
+void RoundEngine<Rules>::PlayRounds(long long rounds, int playerStandValue, Shoe *shoe, RoundCounts *counts) {
+    Player player(0);
+    Dealer dealer;
+    long long i = 0;
+    while(i < rounds) {
+        int result = PlayRound(&player, &dealer, playerStandValue, shoe);
+        if(result == playerwin) {
+            counts->wins = counts->wins + 1;
+        } else {
+            if(result == playerloss) {
+                counts->losses = counts->losses + 1;
+            } else {
+                counts->ties = counts->ties + 1;
+            }
+        }
+        i = i + 1;
+    }
+}
+
+/*
+ RuleConfig Struct
+
+ The same rules as RuleSet, as run time values, so a tool can pick them from its
+ arguments. FindRuleVariant maps one to the matching compiled RoundEngine.
+
+ Members:
+   - dealerStand, bustLimit, winReward, lossPenalty, minCard, maxCard, decks: See RuleSet
+
+ Author: Kerem Cakmak
+ */
+struct RuleConfig {
+    int dealerStand;
+    int bustLimit;
+    int winReward;
+    int lossPenalty;
+    int minCard;
+    int maxCard;
+    int decks;
+};
+
+typedef void (*RoundsFunction)(long long rounds, int playerStandValue, Shoe *shoe, RoundCounts *counts);
+
+RuleConfig StandardRuleConfig();
+bool SameRules(RuleConfig a, RuleConfig b);
+RoundsFunction FindRuleVariant(RuleConfig rules);
+int RuleVariantCount();
+RuleConfig RuleVariantAt(int index);
+
+#endif // RULES_H
@@ -0,0 +1,168 @@
+#include "shoe.h"
+#include "blackjack.h"
+#include "FEHRandom.h"
+
+/*
+ Shoe Constructor
+
+ This function fills the shoe with numDecks decks in order. The shoe starts
+ out used up, so the first StartRound shuffles it. That way a shoe made at
+ program start is not shuffled before FEHRandom has been seeded.
+
+ Input Arguments:
+   - numDecks: Number of 36 card decks (at least 1)
+   - penetration: Fraction of the shoe dealt before the cut card (0.0 - 1.0)
+   - reshufflePolicy: shoe_reshuffle_at_cut or shoe_reshuffle_every_round
+
+ Author: Kerem Cakmak
+ */
+Shoe::Shoe(int numDecks, double penetration, int reshufflePolicy) {
+    if(numDecks < 1) {
+        numDecks = 1;
+    }
+    if(penetration < 0.0) {
+        penetration = 0.0;
+    }
+    if(penetration > 1.0) {
+        penetration = 1.0;
+    }
+
+    decks = numDecks;
+    policy = reshufflePolicy;
+    cards.resize(decks * deck_size);
+
+    int i = 0;
+    int card = min_card;
+    while(card <= max_card) {
+        int copies = 0;
+        while(copies < decks * cards_per_rank) {
+            cards[i] = (unsigned char)card;
+            i = i + 1;
+            copies = copies + 1;
+        }
+        card = card + 1;
+    }
+
+    cutCard = (int)(cards.size() * penetration);
+    Invalidate();
+}
+
+/*
+ StartRound Function
+
+ This function is called before each round is dealt. It shuffles when the
+ cut card came out last round, or every round for shoe_reshuffle_every_round.
+
+ Input Arguments: None
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+void Shoe::StartRound() {
+    if(policy == shoe_reshuffle_every_round || NeedsShuffle()) {
+        Shuffle();
+    }
+}
+
+// shuffles with the calling thread's FEHRandom stream
+void Shoe::Shuffle() {
+    Shuffle(&Random.Stream());
+}
+
+/*
+ Shuffle Function
+
+ This function puts every card back in the shoe and shuffles it in place
+ with the Fisher-Yates algorithm, so every order is equally likely.
+
+ Input Arguments:
+   - stream: Random stream to shuffle with
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+void Shoe::Shuffle(RandomStream *stream) {
+    Shoe *self = this;
+    ShuffleShoes(&self, 1, stream);
+}
+
+/*
+ ShuffleShoes Function
+
+ This function shuffles many shoes at once. It runs Fisher-Yates on all of them
+ in lockstep: at each position it picks the swap for every shoe before moving on,
+ so the random numbers are drawn in one tight loop and the swaps for different
+ shoes are independent of each other, which lets the CPU overlap their cache misses.
+ Each shoe gets the same result as if it had been shuffled alone with the same numbers.
+
+ Input Arguments:
+   - shoes: Array of shoes to shuffle (all must have the same number of decks)
+   - count: Number of shoes
+   - stream: Random stream to shuffle with
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+void ShuffleShoes(Shoe *shoes[], int count, RandomStream *stream) {
+    if(count <= 0) {
+        return;
+    }
+
+    int s = 0;
+    while(s < count) {
+        Shoe *shoe = shoes[s];
+        shoe->next = 0;
+        int card = min_card;
+        while(card <= max_card) {
+            shoe->remaining[card] = shoe->decks * cards_per_rank;
+            card = card + 1;
+        }
+        s = s + 1;
+    }
+
+    std::vector<int> picks(count);
+    int size = (int)shoes[0]->cards.size();
+    int i = size - 1;
+    while(i > 0) {
+        // pick the swap position for every shoe first
+        s = 0;
+        while(s < count) {
+            picks[s] = stream->Range(0, i);
+            s = s + 1;
+        }
+
+        // then do the swaps
+        s = 0;
+        while(s < count) {
+            unsigned char *cards = shoes[s]->cards.data();
+            unsigned char temp = cards[i];
+            cards[i] = cards[picks[s]];
+            cards[picks[s]] = temp;
+            s = s + 1;
+        }
+        i = i - 1;
+    }
+}
+
+/*
+ DrawCard Function
+
+ This function deals one card from a shoe, or from the infinite deck
+ (DealCard) when no shoe is given.
+
+ Input Arguments:
+   - shoe: Shoe to deal from, or NULL for the infinite deck
+
+ Return Value: Integer card value (2-10)
+
+ Author: Kerem Cakmak
+ */
+int DrawCard(Shoe *shoe) {
+    if(shoe == NULL) {
+        return DealCard();
+    }
+    return shoe->Draw();
+}
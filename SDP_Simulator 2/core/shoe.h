@@ -0,0 +1,100 @@
+#ifndef SHOE_H
+#define SHOE_H
+
+#include <vector>
+
+class RandomStream;
+
+#define min_card 2
+#define max_card 10
+#define cards_per_rank 4
+#define deck_size ((max_card - min_card + 1) * cards_per_rank)
+
+#define shoe_reshuffle_at_cut 0
+#define shoe_reshuffle_every_round 1
+
+/*
+ Shoe Class
+
+ This class models a dealing shoe made of several decks, so cards that were
+ already dealt cannot come up again until the next shuffle.
+ The game only uses cards 2-10, so one deck is four of each value (36 cards),
+ which keeps the same odds per card as DealCard when the shoe is full.
+
+ Private Members:
+   - cards: All cards in the shoe in dealing order, stored as bytes in one array
+   - next: Index of the next card to deal
+   - cutCard: Index of the cut card, reaching it means a shuffle before the next round
+   - decks: Number of decks in the shoe
+   - policy: shoe_reshuffle_at_cut or shoe_reshuffle_every_round
+   - remaining[max_card + 1]: How many of each card value are still in the shoe
+
+ Public Members:
+   - Draw(): Deals the next card
+   - StartRound(): Shuffles if the reshuffle policy says so, call before dealing a round
+   - Shuffle(): Puts every card back and shuffles the whole shoe
+   - NeedsShuffle(): Returns true if the cut card has been reached
+   - GetRemaining(), GetRemainingOfValue(int card), GetSize(), GetDecks(): Shoe contents
+
+ Author: Kerem Cakmak
+ */
+class Shoe {
+private:
+    std::vector<unsigned char> cards;
+    int next;
+    int cutCard;
+    int decks;
+    int policy;
+    int remaining[max_card + 1];
+
+public:
+    Shoe(int numDecks, double penetration, int reshufflePolicy);
+
+    // deals the next card, shuffling first if the shoe ran out mid-round
+    int Draw() {
+        if(next >= (int)cards.size()) {
+            Shuffle();
+        }
+        int card = cards[next];
+        next = next + 1;
+        remaining[card] = remaining[card] - 1;
+        return card;
+    }
+
+    void StartRound();
+    void Shuffle();
+    void Shuffle(RandomStream *stream);
+
+    // returns true once the cut card has come out
+    bool NeedsShuffle() {
+        return next >= cutCard;
+    }
+
+    // marks the shoe as used up, so the next StartRound shuffles it
+    void Invalidate() {
+        next = (int)cards.size();
+    }
+
+    // returns number of cards left before the shoe is empty
+    int GetRemaining() {
+        return (int)cards.size() - next;
+    }
+
+    // returns how many cards of one value are left in the shoe
+    int GetRemainingOfValue(int card) {
+        if(card >= min_card && card <= max_card) {
+            return remaining[card];
+        }
+        return 0;
+    }
+
+    int GetSize() { return (int)cards.size(); }
+    int GetDecks() { return decks; }
+
+    friend void ShuffleShoes(Shoe *shoes[], int count, RandomStream *stream);
+};
+
+void ShuffleShoes(Shoe *shoes[], int count, RandomStream *stream);
+int DrawCard(Shoe *shoe);
+
+#endif // SHOE_H
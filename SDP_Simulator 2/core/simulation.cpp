@@ -0,0 +1,278 @@
+#include "simulation.h"
+#include "blackjack.h"
+#include "shoe.h"
+#include "handbatch.h"
+#include "FEHRandom.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+/*
+ DefaultSimulationConfig Function
+
+ This function returns the settings used when the simulator is run without arguments.
+
+ Input Arguments: None
+
+ Return Value: SimulationConfig with one million rounds on every core, standing on 17
+
+ Author: Kerem Cakmak
+ */
+SimulationConfig DefaultSimulationConfig() {
+    SimulationConfig config;
+    config.rounds = 1000000;
+    config.threads = 0;
+    config.playerStandValue = 17;
+    config.chunkSize = 1 << 16;
+    config.rules = StandardRuleConfig();
+    config.penetration = 0.75;
+    config.batchSize = 0;
+    config.seed = 1;
+    return config;
+}
+
+/*
+ PlayBatchRounds Function
+
+ This function plays one batch of rounds with the HandBatch kernels: two cards to
+ every player and dealer, then all players play out, then all dealers, then every
+ result is decided at once. Cards are dealt one row at a time, only while some hand
+ still wants one. A busted player's dealer still draws, but those cards are only used
+ by that lane, so the results have the same odds as PlayRound.
+
+ Input Arguments:
+   - players, dealers: Batches to play with (same size)
+   - cards: Buffer of at least GetLanes() cards
+   - results: Buffer of at least GetLanes() results
+   - rounds: Number of lanes to count (at most GetSize())
+   - playerStandValue: Hand value at which the players stop hitting
+   - stats: Counts to add the results to
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+static void PlayBatchRounds(HandBatch *players, HandBatch *dealers, unsigned char *cards, signed char *results, int rounds, int playerStandValue, SimulationStats *stats) {
+    RandomStream *stream = &Random.Stream();
+    int lanes = players->GetLanes();
+
+    players->Clear();
+    dealers->Clear();
+
+    // opening deal, two cards each
+    int i = 0;
+    while(i < 2) {
+        stream->Fill(cards, lanes, 2, 10);
+        players->AddCards(cards);
+        stream->Fill(cards, lanes, 2, 10);
+        dealers->AddCards(cards);
+        i = i + 1;
+    }
+
+    // players hit until they reach their stand value, then dealers follow the rule of 17
+    int hitting = 1;
+    while(hitting == 1) {
+        stream->Fill(cards, lanes, 2, 10);
+        hitting = PlayOutBatch(players, cards, 1, playerStandValue);
+    }
+    hitting = 1;
+    while(hitting == 1) {
+        stream->Fill(cards, lanes, 2, 10);
+        hitting = PlayOutBatch(dealers, cards, 1, dealer_stand_value);
+    }
+
+    DetermineWinnerBatch(players->GetTotals(), dealers->GetTotals(), results, lanes);
+
+    i = 0;
+    while(i < rounds) {
+        if(results[i] == playerwin) {
+            stats->wins = stats->wins + 1;
+        } else {
+            if(results[i] == playerloss) {
+                stats->losses = stats->losses + 1;
+            } else {
+                stats->ties = stats->ties + 1;
+            }
+        }
+        i = i + 1;
+    }
+}
+
+/*
+ SimulationWorker Function
+
+ This function is run by every thread in the pool. It keeps claiming chunks of rounds
+ from the shared counter until all rounds are taken, and counts the results locally
+ so threads never write to the same memory while playing.
+ Each chunk reseeds this thread's FEHRandom stream with the chunk number and starts
+ from a freshly shuffled shoe, so which thread plays a chunk does not change its cards.
+ The rounds are played by the engine compiled for config.rules, found once by RunSimulation.
+
+ Input Arguments:
+   - config: Simulation settings
+   - play: Engine for config.rules
+   - nextRound: Shared counter of rounds already claimed
+   - stats: This worker's own result slot
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+static void SimulationWorker(SimulationConfig config, RoundsFunction play, std::atomic<long long> *nextRound, SimulationStats *stats) {
+    Shoe shoe(config.rules.decks, config.penetration, shoe_reshuffle_at_cut);
+    RoundCounts counts;
+    counts.wins = 0;
+    counts.losses = 0;
+    counts.ties = 0;
+
+    // batch mode buffers, only used when config.batchSize > 0
+    int batchSize = config.batchSize;
+    if(batchSize < 0 || SameRules(config.rules, StandardRuleConfig()) == false) {
+        batchSize = 0;
+    }
+    HandBatch players(batchSize);
+    HandBatch dealers(batchSize);
+    std::vector<unsigned char> cards(players.GetLanes());
+    std::vector<signed char> results(players.GetLanes());
+    SimulationStats batchStats;
+    batchStats.wins = 0;
+    batchStats.losses = 0;
+    batchStats.ties = 0;
+
+    while(true) {
+        long long start = nextRound->fetch_add(config.chunkSize);
+        if(start >= config.rounds) {
+            break;
+        }
+        long long end = start + config.chunkSize;
+        if(end > config.rounds) {
+            end = config.rounds;
+        }
+        Random.Seed(config.seed, (unsigned long long)(start / config.chunkSize));
+        shoe.Invalidate();
+
+        long long i = start;
+        while(batchSize > 0 && i < end) {
+            long long rounds = end - i;
+            if(rounds > batchSize) {
+                rounds = batchSize;
+            }
+            PlayBatchRounds(&players, &dealers, cards.data(), results.data(), (int)rounds, config.playerStandValue, &batchStats);
+            i = i + rounds;
+        }
+        play(end - i, config.playerStandValue, &shoe, &counts);
+    }
+
+    stats->wins = counts.wins + batchStats.wins;
+    stats->losses = counts.losses + batchStats.losses;
+    stats->ties = counts.ties + batchStats.ties;
+    stats->rounds = stats->wins + stats->losses + stats->ties;
+}
+
+/*
+ RunSimulation Function
+
+ This function plays config.rounds headless rounds on a pool of worker threads
+ and adds up their results.
+
+ Input Arguments:
+   - config: Simulation settings
+
+ Return Value: SimulationStats with the combined counts and the wall clock time,
+ no rounds are played if there is no compiled engine for config.rules
+
+ Author: Kerem Cakmak
+ */
+SimulationStats RunSimulation(SimulationConfig config) {
+    int threads = config.threads;
+    if(threads <= 0) {
+        threads = (int)std::thread::hardware_concurrency();
+        if(threads <= 0) {
+            threads = 1;
+        }
+    }
+    if(config.chunkSize <= 0) {
+        config.chunkSize = 1;
+    }
+
+    SimulationStats total;
+    total.rounds = 0;
+    total.wins = 0;
+    total.losses = 0;
+    total.ties = 0;
+    total.winReward = config.rules.winReward;
+    total.lossPenalty = config.rules.lossPenalty;
+    total.threads = 0;
+    total.seconds = 0.0;
+
+    // pick the engine for these rules once, so no round checks them
+    RoundsFunction play = FindRuleVariant(config.rules);
+    if(play == NULL) {
+        return total;
+    }
+
+    std::atomic<long long> nextRound(0);
+    std::vector<SimulationStats> workerStats(threads);
+    std::vector<std::thread> pool;
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    int i = 0;
+    while(i < threads) {
+        pool.push_back(std::thread(SimulationWorker, config, play, &nextRound, &workerStats[i]));
+        i = i + 1;
+    }
+
+    total.threads = threads;
+
+    i = 0;
+    while(i < threads) {
+        pool[i].join();
+        total.rounds = total.rounds + workerStats[i].rounds;
+        total.wins = total.wins + workerStats[i].wins;
+        total.losses = total.losses + workerStats[i].losses;
+        total.ties = total.ties + workerStats[i].ties;
+        i = i + 1;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    total.seconds = elapsed.count();
+    return total;
+}
+
+// returns the average money won per round
+double ExpectedValue(SimulationStats stats) {
+    if(stats.rounds == 0) {
+        return 0.0;
+    }
+    double won = (double)stats.wins * stats.winReward - (double)stats.losses * stats.lossPenalty;
+    return won / (double)stats.rounds;
+}
+
+// returns the variance of the money won per round
+double Variance(SimulationStats stats) {
+    if(stats.rounds == 0) {
+        return 0.0;
+    }
+    double squares = (double)stats.wins * stats.winReward * stats.winReward + (double)stats.losses * stats.lossPenalty * stats.lossPenalty;
+    double mean = ExpectedValue(stats);
+    return squares / (double)stats.rounds - mean * mean;
+}
+
+// returns the standard error of the expected value estimate
+double StandardError(SimulationStats stats) {
+    if(stats.rounds == 0) {
+        return 0.0;
+    }
+    return std::sqrt(Variance(stats) / (double)stats.rounds);
+}
+
+// returns how many rounds were played per second of wall clock time
+double HandsPerSecond(SimulationStats stats) {
+    if(stats.seconds <= 0.0) {
+        return 0.0;
+    }
+    return (double)stats.rounds / stats.seconds;
+}
@@ -0,0 +1,70 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "rules.h"
+
+/*
+ SimulationConfig Struct
+
+ Settings for a headless Monte Carlo run.
+
+ Members:
+   - rounds: Total number of rounds to play across all threads
+   - threads: Number of worker threads (0 uses every core)
+   - playerStandValue: Hand value at which the simulated player stops hitting
+   - chunkSize: Rounds a worker claims at a time from the shared counter
+   - rules: Rules to play by, rules.decks of 0 deals from the infinite deck, otherwise each
+     worker has its own shoe. Must be one of the compiled variants (see FindRuleVariant)
+   - penetration: Fraction of the shoe dealt before it is reshuffled
+   - batchSize: 0 plays one round at a time with PlayRound. Above 0, rounds are played
+     batchSize at a time with the HandBatch SIMD kernels (standard rules, infinite deck only)
+   - seed: Random seed. Every chunk uses its own FEHRandom stream of this seed,
+     so the same seed gives the same results with any number of threads
+
+ Author: Kerem Cakmak
+ */
+struct SimulationConfig {
+    long long rounds;
+    int threads;
+    int playerStandValue;
+    long long chunkSize;
+    RuleConfig rules;
+    double penetration;
+    int batchSize;
+    unsigned long long seed;
+};
+
+/*
+ SimulationStats Struct
+
+ Totals collected by RunSimulation. Each round pays winReward, -lossPenalty or 0,
+ so the win/loss/tie counts are enough to get the exact mean and variance.
+
+ Members:
+   - rounds, wins, losses, ties: Round counts (all 0 if the rules were not compiled)
+   - winReward, lossPenalty: Payouts of the rules that were played
+   - threads: Number of worker threads that were used
+   - seconds: Wall clock time of the run
+
+ Author: Kerem Cakmak
+ */
+struct SimulationStats {
+    long long rounds;
+    long long wins;
+    long long losses;
+    long long ties;
+    int winReward;
+    int lossPenalty;
+    int threads;
+    double seconds;
+};
+
+SimulationConfig DefaultSimulationConfig();
+SimulationStats RunSimulation(SimulationConfig config);
+
+double ExpectedValue(SimulationStats stats);
+double Variance(SimulationStats stats);
+double StandardError(SimulationStats stats);
+double HandsPerSecond(SimulationStats stats);
+
+#endif // SIMULATION_H
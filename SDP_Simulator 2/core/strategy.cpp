@@ -0,0 +1,362 @@
+#include "strategy.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// mixes a finite state key into a bucket index (splitmix64 finalizer)
+size_t EVSolver::StateHash::operator()(const StateKey &key) const {
+    unsigned long long h = key.composition ^ ((unsigned long long)key.state * 0x9E3779B97F4A7C15ULL);
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return (size_t)(h ^ (h >> 31));
+}
+
+EVSolver::EVSolver() {
+    Clear();
+}
+
+// forgets every remembered state
+void EVSolver::Clear() {
+    int upcard = 0;
+    while(upcard <= max_card) {
+        int total = 0;
+        while(total <= blackjack_value) {
+            int count = 0;
+            while(count <= max_cards) {
+                infiniteKnown[upcard][total][count] = false;
+                count = count + 1;
+            }
+            total = total + 1;
+        }
+        upcard = upcard + 1;
+    }
+    finiteHit.clear();
+    dealer.Clear();
+}
+
+/*
+ StandPayout Function
+
+ This function gives the expected money for standing on a total, given how
+ likely each final dealer outcome is.
+
+ Input Arguments:
+   - playerTotal: Player's hand value (21 or less)
+   - dealerProbs: Array of dealer_outcomes probabilities (17, 18, 19, 20, 21, bust)
+
+ Return Value: Expected money for the round
+
+ Author: Kerem Cakmak
+ */
+double StandPayout(int playerTotal, const double *dealerProbs) {
+    double ev = 0.0;
+    int outcome = 0;
+    while(outcome < dealer_outcomes) {
+        int dealerTotal = dealer_stand_value + outcome;
+        if(outcome == dealer_bust) {
+            dealerTotal = blackjack_value + 1;
+        }
+        ev = ev + dealerProbs[outcome] * RoundPayout(DetermineWinner(playerTotal, dealerTotal));
+        outcome = outcome + 1;
+    }
+    return ev;
+}
+
+// copies counts into local and adds them up, returns false if the shoe is too large to pack
+static bool CopyComposition(const int *counts, int *local, int *left) {
+    bool fits = true;
+    *left = 0;
+    int card = 0;
+    while(card <= max_card) {
+        local[card] = 0;
+        if(card >= min_card) {
+            local[card] = counts[card];
+            if(local[card] < 0) {
+                local[card] = 0;
+            }
+            if(local[card] > dealer_key_max) {
+                fits = false;
+            }
+            *left = *left + local[card];
+        }
+        card = card + 1;
+    }
+    return fits;
+}
+
+/*
+ StandEV Function
+
+ This function gives the expected money for standing on a total.
+
+ Input Arguments:
+   - total: Player's hand value
+   - upcard: Dealer's visible card (2-10)
+   - counts: Cards that can still be dealt, or NULL for the infinite deck
+
+ Return Value: Expected money for the round
+
+ Author: Kerem Cakmak
+ */
+double EVSolver::StandEV(int total, int upcard, const int *counts) {
+    if(total > blackjack_value) {
+        return -loss_penalty;
+    }
+    double probs[dealer_outcomes];
+    if(counts == NULL) {
+        InfiniteDealerProbabilities(upcard, probs);
+    } else {
+        dealer.Compute(upcard, counts, probs);
+    }
+    return StandPayout(total, probs);
+}
+
+/*
+ HitEV Function
+
+ This function gives the expected money for taking one card and then
+ playing the rest of the hand perfectly.
+
+ Input Arguments:
+   - total: Player's hand value
+   - count: Number of cards in the player's hand
+   - upcard: Dealer's visible card (2-10)
+   - counts: Cards that can still be dealt, or NULL for the infinite deck
+
+ Return Value: Expected money for the round (-loss_penalty if the hand cannot take a card)
+
+ Author: Kerem Cakmak
+ */
+double EVSolver::HitEV(int total, int count, int upcard, const int *counts) {
+    if(total > blackjack_value || count >= max_cards) {
+        return -loss_penalty;
+    }
+    if(counts == NULL) {
+        return InfiniteHitEV(total, count, upcard);
+    }
+    int local[max_card + 1];
+    int left = 0;
+    if(CopyComposition(counts, local, &left) == false) {
+        return InfiniteHitEV(total, count, upcard);
+    }
+    return FiniteHitEV(total, count, upcard, local, left);
+}
+
+// returns the better of hitting and standing (standing only once the hand is full)
+double EVSolver::BestEV(int total, int count, int upcard, const int *counts) {
+    double stand = StandEV(total, upcard, counts);
+    if(total > blackjack_value || count >= max_cards) {
+        return stand;
+    }
+    double hit = HitEV(total, count, upcard, counts);
+    if(hit > stand) {
+        return hit;
+    }
+    return stand;
+}
+
+// infinite deck hit EV, every card 1/9, remembered per (upcard, total, count)
+double EVSolver::InfiniteHitEV(int total, int count, int upcard) {
+    if(infiniteKnown[upcard][total][count] == true) {
+        return infiniteHit[upcard][total][count];
+    }
+
+    double ev = 0.0;
+    int card = min_card;
+    while(card <= max_card) {
+        int next = total + card;
+        double cardEV = -loss_penalty;
+        if(next <= blackjack_value) {
+            cardEV = StandEV(next, upcard, NULL);
+            if(count + 1 < max_cards) {
+                double hit = InfiniteHitEV(next, count + 1, upcard);
+                if(hit > cardEV) {
+                    cardEV = hit;
+                }
+            }
+        }
+        ev = ev + cardEV / (max_card - min_card + 1);
+        card = card + 1;
+    }
+
+    infiniteHit[upcard][total][count] = ev;
+    infiniteKnown[upcard][total][count] = true;
+    return ev;
+}
+
+/*
+ FiniteHitEV Function
+
+ This function tries every card left, weighted by how many of it are left, and takes
+ the better of standing and hitting again after it. The dealer then draws from what
+ is left after the player's cards. If the shoe runs out the game reshuffles, which
+ is close enough to the infinite deck to use it.
+
+ Input Arguments:
+   - total, count: Player's hand value and number of cards
+   - upcard: Dealer's visible card
+   - counts: Cards left, changed during the search but restored
+   - left: Sum of counts
+
+ Return Value: Expected money for the round
+
+ Author: Kerem Cakmak
+ */
+double EVSolver::FiniteHitEV(int total, int count, int upcard, int *counts, int left) {
+    if(left <= 0) {
+        return InfiniteHitEV(total, count, upcard);
+    }
+
+    StateKey key;
+    key.composition = PackComposition(counts);
+    key.state = (upcard << 16) | (total << 8) | count;
+    std::unordered_map<StateKey, double, StateHash>::iterator found = finiteHit.find(key);
+    if(found != finiteHit.end()) {
+        return found->second;
+    }
+
+    double ev = 0.0;
+    int card = min_card;
+    while(card <= max_card) {
+        if(counts[card] > 0) {
+            double p = (double)counts[card] / left;
+            int next = total + card;
+            if(next > blackjack_value) {
+                ev = ev - p * loss_penalty;
+            } else {
+                counts[card] = counts[card] - 1;
+                ev = ev + p * FiniteBestEV(next, count + 1, upcard, counts, left - 1);
+                counts[card] = counts[card] + 1;
+            }
+        }
+        card = card + 1;
+    }
+
+    finiteHit[key] = ev;
+    return ev;
+}
+
+// better of standing and hitting for a finite composition that is already copied
+double EVSolver::FiniteBestEV(int total, int count, int upcard, int *counts, int left) {
+    double probs[dealer_outcomes];
+    dealer.Compute(upcard, counts, probs);
+    double stand = StandPayout(total, probs);
+    if(count >= max_cards) {
+        return stand;
+    }
+    double hit = FiniteHitEV(total, count, upcard, counts, left);
+    if(hit > stand) {
+        return hit;
+    }
+    return stand;
+}
+
+/*
+ StrategyWorker Function
+
+ This function is run by every thread building the strategy table. It keeps claiming
+ dealer upcards from the shared counter and fills in that column with its own solver,
+ so threads never share memory while solving.
+
+ Input Arguments:
+   - table: Table to fill (each column is written by one thread only)
+   - nextUpcard: Shared counter of upcards already claimed
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+static void StrategyWorker(StrategyTable *table, std::atomic<int> *nextUpcard) {
+    EVSolver solver;
+    while(true) {
+        int upcard = nextUpcard->fetch_add(1);
+        if(upcard > max_card) {
+            break;
+        }
+        int total = strategy_min_total;
+        while(total <= blackjack_value) {
+            double hit = solver.HitEV(total, 2, upcard, NULL);
+            double stand = solver.StandEV(total, upcard, NULL);
+            table->hitEV[total][upcard] = hit;
+            table->standEV[total][upcard] = stand;
+            if(hit > stand) {
+                table->action[total][upcard] = action_hit;
+            } else {
+                table->action[total][upcard] = action_stand;
+            }
+            total = total + 1;
+        }
+    }
+}
+
+/*
+ BuildStrategyTable Function
+
+ This function solves every player total against every dealer upcard exactly, for the
+ infinite deck, and works out the EV of a whole round played by the table. The upcards
+ are shared out over a pool of threads. Run it again after changing any rule.
+
+ Input Arguments:
+   - threads: Number of threads (0 uses every core)
+
+ Return Value: The filled StrategyTable
+
+ Author: Kerem Cakmak
+ */
+StrategyTable BuildStrategyTable(int threads) {
+    if(threads <= 0) {
+        threads = (int)std::thread::hardware_concurrency();
+        if(threads <= 0) {
+            threads = 1;
+        }
+    }
+    if(threads > max_card - min_card + 1) {
+        threads = max_card - min_card + 1;
+    }
+
+    StrategyTable table = {};
+    table.threads = threads;
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    std::atomic<int> nextUpcard(min_card);
+    std::vector<std::thread> pool;
+    int i = 0;
+    while(i < threads) {
+        pool.push_back(std::thread(StrategyWorker, &table, &nextUpcard));
+        i = i + 1;
+    }
+    i = 0;
+    while(i < threads) {
+        pool[i].join();
+        i = i + 1;
+    }
+
+    // a round starts with two player cards and one dealer upcard, every card 1/9
+    double cards = max_card - min_card + 1;
+    double roundEV = 0.0;
+    int upcard = min_card;
+    while(upcard <= max_card) {
+        int first = min_card;
+        while(first <= max_card) {
+            int second = min_card;
+            while(second <= max_card) {
+                int total = first + second;
+                double best = table.standEV[total][upcard];
+                if(table.hitEV[total][upcard] > best) {
+                    best = table.hitEV[total][upcard];
+                }
+                roundEV = roundEV + best / (cards * cards * cards);
+                second = second + 1;
+            }
+            first = first + 1;
+        }
+        upcard = upcard + 1;
+    }
+    table.roundEV = roundEV;
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    table.seconds = elapsed.count();
+    return table;
+}
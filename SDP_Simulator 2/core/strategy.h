@@ -0,0 +1,104 @@
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#include <stddef.h>
+#include <unordered_map>
+
+#include "blackjack.h"
+#include "dealerprob.h"
+
+#define action_stand 0
+#define action_hit 1
+
+// lowest total a two card hand can have
+#define strategy_min_total (2 * min_card)
+
+/*
+ StrategyTable Struct
+
+ Exact EV of hitting and standing for every player total and dealer upcard,
+ and the better of the two, for the infinite 2-10 deck. Indexed [total][upcard],
+ rows strategy_min_total to blackjack_value and columns min_card to max_card are filled.
+
+ Members:
+   - hitEV, standEV: Expected money for the round after hitting once / standing now
+   - action: action_hit or action_stand, whichever has the higher EV
+   - roundEV: Expected money per round when every decision follows the table
+   - threads: Number of threads used to build the table
+   - seconds: Time taken to build the table
+
+ Author: Kerem Cakmak
+ */
+struct StrategyTable {
+    double hitEV[blackjack_value + 1][max_card + 1];
+    double standEV[blackjack_value + 1][max_card + 1];
+    int action[blackjack_value + 1][max_card + 1];
+    double roundEV;
+    int threads;
+    double seconds;
+};
+
+/*
+ EVSolver Class
+
+ This class works out the exact expected money of hitting or standing, by trying
+ every card that can come next and every way the dealer can finish, with the rules
+ in blackjack.h (cards 2-10, max_cards per hand, dealer hits on 16 or less,
+ +win_reward / -loss_penalty). After a hit the player again picks whichever is
+ better, so HitEV assumes the rest of the hand is played perfectly.
+ Every state is solved once and remembered, so the second query is a lookup.
+
+ Every function takes counts, the cards the player could still be dealt
+ (counts[card] for card 2-10, the dealer's hole card counts as not yet seen).
+ NULL means the infinite deck (DealCard). A solver is not thread safe, give every
+ thread its own.
+
+ Private Members:
+   - dealer: Dealer outcome probabilities for finite compositions
+   - infiniteHit, infiniteKnown: Remembered hit EVs for the infinite deck, [upcard][total][cards in hand]
+   - finiteHit: Remembered hit EVs for finite compositions, keyed by composition and state
+
+ Public Members:
+   - StandEV(int total, int upcard, const int *counts): EV of standing now
+   - HitEV(int total, int count, int upcard, const int *counts): EV of taking one card
+     and then playing perfectly
+   - BestEV(int total, int count, int upcard, const int *counts): The better of the two
+   - Clear(): Forgets every remembered state
+
+ Author: Kerem Cakmak
+ */
+class EVSolver {
+private:
+    struct StateKey {
+        unsigned long long composition;
+        int state;
+        bool operator==(const StateKey &other) const {
+            return composition == other.composition && state == other.state;
+        }
+    };
+    struct StateHash {
+        size_t operator()(const StateKey &key) const;
+    };
+
+    DealerCache dealer;
+    double infiniteHit[max_card + 1][blackjack_value + 1][max_cards + 1];
+    bool infiniteKnown[max_card + 1][blackjack_value + 1][max_cards + 1];
+    std::unordered_map<StateKey, double, StateHash> finiteHit;
+
+    double InfiniteHitEV(int total, int count, int upcard);
+    double FiniteHitEV(int total, int count, int upcard, int *counts, int left);
+    double FiniteBestEV(int total, int count, int upcard, int *counts, int left);
+
+public:
+    EVSolver();
+
+    double StandEV(int total, int upcard, const int *counts);
+    double HitEV(int total, int count, int upcard, const int *counts);
+    double BestEV(int total, int count, int upcard, const int *counts);
+    void Clear();
+};
+
+double StandPayout(int playerTotal, const double *dealerProbs);
+StrategyTable BuildStrategyTable(int threads);
+
+#endif // STRATEGY_H
@@ -3,6 +3,9 @@
 #include "FEHRandom.h"
 #include "FEHImages.h"
 #include "FEHKeyboard.h"
+#include "core/blackjack.h"
+#include "core/shoe.h"
+#include "core/hint.h"
 #include <cstring>
 #include <stdio.h>
 #define main_menu_state 0
@@ -18,234 +21,19 @@
 #define instructions_state 10
 #define quit 11
 
-#define playerwin 1 
-#define playerloss -1
-#define playertie 0
-
-#define max_cards 11
 #define max_inventory 10
-#define win_reward 100
-#define loss_penalty 50
 #define starting_money 100
 
 #define max_session_time 300
 #define max_round_time 60
 
-/*
- Hand Class
- 
- This class manages a player's or dealer's hand of cards in blackjack.
- It stores the cards, keeps track of how many cards are in the hand, and calculates the total hand value.
- 
- Private Members:
-   - cards[max_cards]: Array that stores card values (2-10)
-   - count: Number of cards currently in the hand
- 
- Public Members:
-   - AddCard(int card): Adds a new card to the hand
-   - GetValue(): Returns the total value of all cards in the hand
-   - GetCount(): Returns how many cards are in the hand
-   - GetCard(int index): Returns the card at a specific index
-   - Clear(): Resets the hand to empty for a new round
- 
- Author: Akshit Jalli
- */
-class Hand {
-private:
-    int cards[max_cards];
-    int count;
-    
-public:
-    // constructor initializes empty hand
-    Hand() {
-        count = 0;
-        int i = 0;
-        while(i < max_cards) {
-            cards[i] = 0;
-            i = i + 1;
-        }
-    }
-    
-    // adds a card to the hand
-    void AddCard(int card) {
-        if(count < max_cards) {
-            cards[count] = card;
-            count = count + 1;
-        }
-    }
-    
-    // calculates and returns total hand value
-    int GetValue() {
-        int value = 0;
-        int i = 0;
-        while(i < count) {
-            value = value + cards[i];
-            i = i + 1;
-        }
-        return value;
-    }
-    
-    // returns number of cards in hand
-    int GetCount() {
-        return count;
-    }
-    
-    // returns card at specified index
-    int GetCard(int index) {
-        if(index >= 0 && index < count) {
-            return cards[index];
-        }
-        return 0;
-    }
-    
-    // clears the hand for new round
-    void Clear() {
-        count = 0;
-        int i = 0;
-        while(i < max_cards) {
-            cards[i] = 0;
-            i = i + 1;
-        }
-    }
-};
+// 0 deals from an infinite deck with DealCard, as the game always has; set it to
+// the number of decks (e.g. 6) to deal from a shoe with a cut card instead
+#define shoe_decks 0
+#define shoe_penetration 0.75
 
-/*
- Player Class
- 
- This class represents a human player in the blackjack game.
- It manages the player's hand of cards, their money, and whether they've chosen to stand.
- 
- Private Members:
-   - hand: Hand object that stores the player's cards
-   - money: The player's current money amount
-   - hasStood: Whether the player has chosen to stand (stop taking cards)
- 
- Public Members:
-   - GetHand(): Returns a reference to the player's hand
-   - GetMoney(): Returns the player's current money
-   - AddMoney(int amount): Adds money to the player's total
-   - Stand(): Player chooses to stand and end their turn
-   - HasStood(): Returns true if the player has stood, false otherwise
-   - Reset(): Resets the player for a new round
- 
- Author: Akshit Jalli
- */
-class Player {
-private:
-    Hand hand;
-    int money;
-    bool hasStood;
-    
-public:
-    // constructor initializes player with starting money
-    Player(int startingMoney) {
-        money = startingMoney;
-        hasStood = false;
-    }
-    
-    // returns pointer to player's hand
-    Hand* GetHand() {
-        return &hand;
-    }
-    
-    // returns player's current money
-    int GetMoney() {
-        return money;
-    }
-    
-    // sets player's money amount
-    void SetMoney(int amount) {
-        money = amount;
-        if(money < 0) {
-            money = 0;
-        }
-    }
-    
-    // adds money to player's total
-    void AddMoney(int amount) {
-        money = money + amount;
-        if(money < 0) {
-            money = 0;
-        }
-    }
-    
-    // player chooses to stand
-    void Stand() {
-        hasStood = true;
-    }
-    
-    // checks if player has stood
-    bool HasStood() {
-        return hasStood;
-    }
-    
-    // resets player for new round
-    void Reset() {
-        hand.Clear();
-        hasStood = false;
-    }
-};
-
-/*
- Dealer Class
- 
- This class represents the dealer (AI opponent) in single-player blackjack.
- It manages the dealer's hand and implements the dealer AI logic for playing.
- 
- Private Members:
-   - hand: Hand object that stores the dealer's cards
-   - hasStood: Whether the dealer has finished playing their turn
- 
- Public Members:
-   - GetHand(): Returns a reference to the dealer's hand
-   - Stand(): Dealer chooses to stand and end their turn
-   - HasStood(): Returns true if the dealer has stood, false otherwise
-   - ShouldHit(): Returns true if dealer should hit (follows Rule of 17: hit if 16 or less)
-   - Reset(): Resets the dealer for a new round
- 
- Author: Kerem Cakmak
- */
-class Dealer {
-private:
-    Hand hand;
-    bool hasStood;
-    
-public:
-    // constructor initializes dealer
-    Dealer() {
-        hasStood = false;
-    }
-    
-    // returns pointer to dealer's hand
-    Hand* GetHand() {
-        return &hand;
-    }
-    
-    // dealer chooses to stand
-    void Stand() {
-        hasStood = true;
-    }
-    
-    // checks if dealer has stood
-    bool HasStood() {
-        return hasStood;
-    }
-    
-    // dealer AI follows rule of 17
-    bool ShouldHit() {
-        int value = hand.GetValue();
-        if(value <= 16) {
-            return true;
-        }
-        return false;
-    }
-    
-    // resets dealer for new round
-    void Reset() {
-        hand.Clear();
-        hasStood = false;
-    }
-};
+// room for two full screen backgrounds, the others are decoded again when next shown
+#define image_cache_budget (640 * 1024)
 
 /*
  Button Class
@@ -342,6 +130,9 @@ const char* loss_quotes[10] = {
 double session_start_time;
 double current_round_start_time;
 
+Shoe game_shoe(shoe_decks, shoe_penetration, shoe_reshuffle_at_cut);
+HintEngine game_hint;
+
 FEHImage main_menu_background;
 int main_menu_image_loaded = 0;
 
@@ -363,6 +154,7 @@ FEHImage shop_background;
 FEHImage arrow_left;
 FEHImage arrow_right;
 int shop_images_loaded = 0;
+int images_ready = 0;
 
 int selected_character = 0;
 int player_x = 160;
@@ -466,7 +258,7 @@ float touch_y;
 
 if(LCD.Touch(&touch_x, &touch_y)){
     while(LCD.Touch(&touch_x, &touch_y)){
-        LCD.Update();
+        LCD.WaitForInput();
     }
     int i = 0;
     while(i < numbuttons){
@@ -485,7 +277,7 @@ return -1;
 /*
  LoadMainMenuImage Function
  
- This function loads the main menu background image from file.
+ This function opens the main menu background image, it is decoded when first drawn.
  It uses a flag to prevent reloading if the image is already loaded.
  
  Input Arguments: None
@@ -499,14 +291,15 @@ void LoadMainMenuImage() {
         return;
     }
     
-    main_menu_background.Open("mainmenufinal.png");
+    main_menu_background.OpenLazy("mainmenufinal.png");
     main_menu_image_loaded = 1;
 }
 
 /*
  LoadGameImages Function
  
- This function loads the game background and all card images from files.
+ This function opens the game background, decoded when first drawn, and starts
+ loading all card images in the background. FinishLoadingImages waits for them.
  It uses a flag to prevent reloading if images are already loaded.
  
  Input Arguments: None
@@ -521,19 +314,19 @@ void LoadGameImages() {
     }
     
     // load game background image
-    game_background.Open("dealer3.png");
+    game_background.OpenLazy("dealer3.png");
     game_background_loaded = 1;
     
     // load card images for values 2 through 10
-    card_images[2].Open("twocard.png");
-    card_images[3].Open("threecard.png");
-    card_images[4].Open("fourcard.png");
-    card_images[5].Open("fivecard.png");
-    card_images[6].Open("sixcard.png");
-    card_images[7].Open("sevencard.png");
-    card_images[8].Open("eightcard.png");
-    card_images[9].Open("ninecard.png");
-    card_images[10].Open("tencard.png");
+    card_images[2].OpenAsync("twocard.png");
+    card_images[3].OpenAsync("threecard.png");
+    card_images[4].OpenAsync("fourcard.png");
+    card_images[5].OpenAsync("fivecard.png");
+    card_images[6].OpenAsync("sixcard.png");
+    card_images[7].OpenAsync("sevencard.png");
+    card_images[8].OpenAsync("eightcard.png");
+    card_images[9].OpenAsync("ninecard.png");
+    card_images[10].OpenAsync("tencard.png");
     
     card_images_loaded = 1;
 }
@@ -541,7 +334,9 @@ void LoadGameImages() {
 /*
  LoadWorldImages Function
  
- This function loads the world background, character sprites, and shop item images.
+ This function opens the world and shop backgrounds, decoded when first drawn, and starts
+ loading the character sprites, shop item images and arrows in the background.
+ FinishLoadingImages waits for them.
  It uses flags to prevent reloading if images are alredy loaded.
  
  Input Arguments: None
@@ -556,75 +351,76 @@ void LoadWorldImages() {
     }
     
     // load world background image
-    world_background.Open("world.png");
+    world_background.OpenLazy("world.png");
     world_background_loaded = 1;
     
     // load character sprite images
-    boy_sprite.Open("Boy.png");
-    girl_sprite.Open("Girl.png");
+    boy_sprite.OpenAsync("Boy.png");
+    girl_sprite.OpenAsync("Girl.png");
     character_sprites_loaded = 1;
     
     // load shop item images
-    shop_item_images[0].Open("DONATE.png");
-    shop_item_images[1].Open("dog.png");
-    shop_item_images[2].Open("LAB REPORT.png");
-    shop_item_images[3].Open("FEH_TEXTBOOK.png");
-    shop_item_images[4].Open("lambo.png");
-    shop_item_images[5].Open("LIBRARY CARD.png");
-    shop_item_images[6].Open("plant2.png");
-    shop_item_images[7].Open("TEACHING_MANUAL.png");
-    shop_item_images[8].Open("present.png");
+    shop_item_images[0].OpenAsync("DONATE.png");
+    shop_item_images[1].OpenAsync("dog.png");
+    shop_item_images[2].OpenAsync("LAB REPORT.png");
+    shop_item_images[3].OpenAsync("FEH_TEXTBOOK.png");
+    shop_item_images[4].OpenAsync("lambo.png");
+    shop_item_images[5].OpenAsync("LIBRARY CARD.png");
+    shop_item_images[6].OpenAsync("plant2.png");
+    shop_item_images[7].OpenAsync("TEACHING_MANUAL.png");
+    shop_item_images[8].OpenAsync("present.png");
     
     // load shop background image
-    shop_background.Open("shopfinal.png");
+    shop_background.OpenLazy("shopfinal.png");
     
     // load navigation arrow images
-    arrow_left.Open("ArrowLeft.png");
-    arrow_right.Open("ArrowRight.png");
+    arrow_left.OpenAsync("ArrowLeft.png");
+    arrow_right.OpenAsync("ArrowRight.png");
     
     shop_images_loaded = 1;
 }
 
 /*
- DealCard Function
+ FinishLoadingImages Function
  
- This function generates a random card value between 2 and 10.
- It uses FEHRandom to meet the random generation requirement for the project.
+ This function waits for the small images still loading in the background and
+ packs them into texture atlases. It runs once, when the game leaves the main
+ menu, so the menu appears as soon as its own image is decoded.
  
  Input Arguments: None
  
- Return Value: Integer card value (2-10, no aces or face cards)
+ Return Value: None (void)
  
- Author: Akshit Jalli, Kerem Cakmak
- Reference: FEHRandom library documentation
+ Author: Kerem Cakmak
  */
-int DealCard() {
-    FEHRandom Random;
-    int randomNum = Random.RandInt();
-    // returns random card value between 2 and 10
-    int card = (randomNum % 9) + 2;
-    return card;
-}
-
-
-int DetermineWinner(int playerValue, int dealerValue) {
-    // player busts if over 21
-    if(playerValue > 21) {
-        return playerloss;
-    }
-    // dealer busts if over 21
-    if(dealerValue > 21) {
-        return playerwin;
+void FinishLoadingImages() {
+    if(images_ready == 1) {
+        return;
     }
-    // compare values if both valid
-    if(playerValue > dealerValue) {
-        return playerwin;
+    
+    // keep the cards in one bitmap, a hand draws them one after another
+    FEHImage *cards[9];
+    int rank = 2;
+    while(rank <= 10) {
+        cards[rank - 2] = &card_images[rank];
+        rank = rank + 1;
     }
-    if(dealerValue > playerValue) {
-        return playerloss;
+    FEHImage::PackAtlas(cards, 9);
+    
+    // keep the sprites, shop items and arrows in one bitmap
+    FEHImage *small_images[14];
+    small_images[0] = &boy_sprite;
+    small_images[1] = &girl_sprite;
+    small_images[2] = &arrow_left;
+    small_images[3] = &arrow_right;
+    int item = 0;
+    while(item < 10) {
+        small_images[item + 4] = &shop_item_images[item];
+        item = item + 1;
     }
-    // equal values result in tie
-    return playertie;
+    FEHImage::PackAtlas(small_images, 14);
+    
+    images_ready = 1;
 }
 
 /*
@@ -806,7 +602,7 @@ int MainMenu(){
                 }
             }
         }
-        LCD.Update();
+        LCD.WaitForInput();
     }
 }
 
@@ -882,7 +678,7 @@ int ModeSelect() {
                 return main_menu_state;
             }
         }
-        LCD.Update();
+        LCD.WaitForInput();
     }
 }
 
@@ -905,15 +701,23 @@ int PlayBlackjack() {
     Dealer dealer;
     int gameOver = 0;
     
+    // deal from the shoe, shuffling it first if the cut card came out last round
+    Shoe *shoe = NULL;
+    if(shoe_decks > 0) {
+        shoe = &game_shoe;
+        shoe->StartRound();
+    }
+    
     // start round timer
     current_round_start_time = TimeNow();
     
     // deal initial cards to player and dealer
-    player.GetHand()->AddCard(DealCard());
-    player.GetHand()->AddCard(DealCard());
+    player.GetHand()->AddCard(DrawCard(shoe));
+    player.GetHand()->AddCard(DrawCard(shoe));
     
-    dealer.GetHand()->AddCard(DealCard());
-    dealer.GetHand()->AddCard(DealCard());
+    dealer.GetHand()->AddCard(DrawCard(shoe));
+    dealer.GetHand()->AddCard(DrawCard(shoe));
+    game_hint.NewRound();
     
     // main game loop
     while(gameOver == 0) {
@@ -933,10 +737,10 @@ int PlayBlackjack() {
             
             float touch_x, touch_y;
             while(!LCD.Touch(&touch_x, &touch_y)) {
-                LCD.Update();
+                LCD.WaitForInput();
             }
             while(LCD.Touch(&touch_x, &touch_y)) {
-                LCD.Update();
+                LCD.WaitForInput();
             }
             return main_menu_state;
         }
@@ -1009,6 +813,29 @@ int PlayBlackjack() {
             char dealerValStr[20];
             sprintf(dealerValStr, "Dealer: %d", dealerValue);
             LCD.WriteAt(dealerValStr, 220, taskbarY + 12);
+        } else {
+            if(playerValue <= 21) {
+                // show the exact EV of each choice, the better one in green
+                // (cached by game_hint, so this only does real work after a card is added)
+                game_hint.Update(player.GetHand(), dealer.GetHand()->GetCard(0), dealer.GetHand()->GetCard(1), shoe);
+                LCD.SetFontScale(0.5);
+                char hitStr[20];
+                char standStr[20];
+                sprintf(hitStr, "Hit:   %+.1f", game_hint.GetHitEV());
+                sprintf(standStr, "Stand: %+.1f", game_hint.GetStandEV());
+                if(game_hint.GetAction() == action_hit) {
+                    LCD.SetFontColor(GREEN);
+                } else {
+                    LCD.SetFontColor(WHITE);
+                }
+                LCD.WriteAt(hitStr, 220, taskbarY + 6);
+                if(game_hint.GetAction() == action_stand) {
+                    LCD.SetFontColor(GREEN);
+                } else {
+                    LCD.SetFontColor(WHITE);
+                }
+                LCD.WriteAt(standStr, 220, taskbarY + 22);
+            }
         }
         
         LCD.SetFontScale(1.0);
@@ -1041,7 +868,7 @@ int PlayBlackjack() {
                 int action = animation(actionButtons, 2);
                 if(action == 0) {
                     // player hits
-                    player.GetHand()->AddCard(DealCard());
+                    player.GetHand()->AddCard(DrawCard(shoe));
                 } else {
                     if(action == 1) {
                         // player stands
@@ -1054,7 +881,7 @@ int PlayBlackjack() {
             if(dealer.HasStood() == false) {
                 // dealer follows rule of 17
                 if(dealer.ShouldHit() == true) {
-                    dealer.GetHand()->AddCard(DealCard());
+                    dealer.GetHand()->AddCard(DrawCard(shoe));
                     Sleep(0.5);
                 } else {
                     dealer.Stand();
@@ -1114,10 +941,10 @@ int PlayBlackjack() {
         // wait for touch input
         float touch_x, touch_y;
         while(!LCD.Touch(&touch_x, &touch_y)) {
-            LCD.Update();
+            LCD.WaitForInput();
         }
         while(LCD.Touch(&touch_x, &touch_y)) {
-            LCD.Update();
+            LCD.WaitForInput();
         }
         
         return main_menu_state;
@@ -1148,10 +975,10 @@ int PlayBlackjack() {
     
     float touch_x, touch_y;
     while(!LCD.Touch(&touch_x, &touch_y)) {
-        LCD.Update();
+        LCD.WaitForInput();
     }
     while(LCD.Touch(&touch_x, &touch_y)) {
-        LCD.Update();
+        LCD.WaitForInput();
     }
     
     return main_menu_state;
@@ -1219,7 +1046,7 @@ int CharacterSelect() {
                 }
             }
         }
-        LCD.Update();
+        LCD.WaitForInput();
     }
 }
 
@@ -1261,13 +1088,16 @@ int World() {
     backButton.SetSize(60, 25);
     backButton.SetText("Back");
     
+    // draw the background once, it does not change
+    LCD.BeginStaticLayer();
+    LCD.Clear(BLACK);
+    if(world_background_loaded == 1) {
+        world_background.Draw(0, 0);
+    }
+    LCD.EndStaticLayer();
+    
     while(1) {
-        LCD.Clear(BLACK);
-        
-        // draw world background
-        if(world_background_loaded == 1) {
-            world_background.Draw(0, 0);
-        }
+        LCD.DrawStaticLayer();
         
         // draw selected character sprite
         if(character_sprites_loaded == 1 && selected_character > 0) {
@@ -1278,6 +1108,7 @@ int World() {
             }
         }
         
+        // back button goes over the sprite
         Blackjackbutton(backButton);
         
         LCD.Update();
@@ -1286,7 +1117,7 @@ int World() {
         float touch_x, touch_y;
         if(LCD.Touch(&touch_x, &touch_y)) {
             while(LCD.Touch(&touch_x, &touch_y)) {
-                LCD.Update();
+                LCD.WaitForInput();
             }
             
             // check back button
@@ -1322,9 +1153,10 @@ int World() {
             if(player_x > 300) player_x = 300;
             if(player_y < 0) player_y = 0;
             if(player_y > 220) player_y = 220;
+        } else {
+            // nothing changes until the screen is touched
+            LCD.WaitForInput();
         }
-        
-        LCD.Update();
     }
 }
 
@@ -1389,7 +1221,7 @@ int Bank() {
         if(pressed == 0) {
             return world_state;
         }
-        LCD.Update();
+        LCD.WaitForInput();
     }
 }
 
@@ -1428,22 +1260,24 @@ int Shop() {
     buyButton.SetSize(120, 25);
     buyButton.SetText("Buy");
     
+    int taskbarY = 130;
+    int taskbarHeight = 110;
+    
+    // draw the background and bottom taskbar once, they do not change
+    LCD.BeginStaticLayer();
+    LCD.Clear(BLACK);
+    if(shop_images_loaded == 1) {
+        shop_background.Draw(0, 0);
+    }
+    LCD.SetFontColor(BLACK);
+    LCD.FillRectangle(0, taskbarY, 319, taskbarHeight);
+    LCD.SetFontColor(WHITE);
+    LCD.DrawRectangle(0, taskbarY, 319, taskbarHeight);
+    LCD.DrawRectangle(1, taskbarY + 1, 317, taskbarHeight - 2);
+    LCD.EndStaticLayer();
+    
     while(1) {
-        LCD.Clear(BLACK);
-        
-        // draw shop background
-        if(shop_images_loaded == 1) {
-            shop_background.Draw(0, 0);
-        }
-        
-        // draw bottom taskbar
-        int taskbarY = 130;
-        int taskbarHeight = 110;
-        LCD.SetFontColor(BLACK);
-        LCD.FillRectangle(0, taskbarY, 319, taskbarHeight);
-        LCD.SetFontColor(WHITE);
-        LCD.DrawRectangle(0, taskbarY, 319, taskbarHeight);
-        LCD.DrawRectangle(1, taskbarY + 1, 317, taskbarHeight - 2);
+        LCD.DrawStaticLayer();
         
         // draw item image on left side of taskbar
         if(shop_images_loaded == 1) {
@@ -1507,14 +1341,13 @@ int Shop() {
         }
         
         Blackjackbutton(backButton);
-        
         LCD.Update();
         
         // handle touch input
         float touch_x, touch_y;
         if(LCD.Touch(&touch_x, &touch_y)) {
             while(LCD.Touch(&touch_x, &touch_y)) {
-                LCD.Update();
+                LCD.WaitForInput();
             }
             
             // check back button
@@ -1558,9 +1391,10 @@ int Shop() {
                     Sleep(0.5);
                 }
             }
+        } else {
+            // nothing changes until the screen is touched
+            LCD.WaitForInput();
         }
-        
-        LCD.Update();
     }
 }
 
@@ -1592,14 +1426,17 @@ int Inventory() {
     int right_arrow_x = 280;
     int right_arrow_y = 110;
     
+    // draw the title once, it does not change
+    LCD.BeginStaticLayer();
+    LCD.Clear(BLACK);
+    LCD.SetFontColor(WHITE);
+    LCD.SetFontScale(0.8);
+    LCD.WriteAt("INVENTORY", 100, 5);
+    LCD.SetFontScale(1.0);
+    LCD.EndStaticLayer();
+    
     while(1) {
-        LCD.Clear(BLACK);
-        
-        // display inventory title
-        LCD.SetFontColor(WHITE);
-        LCD.SetFontScale(0.8);
-        LCD.WriteAt("INVENTORY", 100, 5);
-        LCD.SetFontScale(1.0);
+        LCD.DrawStaticLayer();
         
         // check if inventory is empty
         if(inventory_items == 0) {
@@ -1614,7 +1451,7 @@ int Inventory() {
             if(pressed == 0) {
                 return main_menu_state;
             }
-            LCD.Update();
+            LCD.WaitForInput();
             continue;
         }
         
@@ -1660,14 +1497,13 @@ int Inventory() {
         LCD.SetFontScale(1.0);
         
         Blackjackbutton(backButton);
-        
         LCD.Update();
         
         // handle touch input
         float touch_x, touch_y;
         if(LCD.Touch(&touch_x, &touch_y)) {
             while(LCD.Touch(&touch_x, &touch_y)) {
-                LCD.Update();
+                LCD.WaitForInput();
             }
             
             // check back button
@@ -1694,9 +1530,10 @@ int Inventory() {
                     }
                 }
             }
+        } else {
+            // nothing changes until the screen is touched
+            LCD.WaitForInput();
         }
-        
-        LCD.Update();
     }
 }
 
@@ -1739,7 +1576,7 @@ int Credits() {
         if(pressed == 0) {
             return main_menu_state;
         }
-        LCD.Update();
+        LCD.WaitForInput();
     }
 }
 
@@ -1800,7 +1637,7 @@ int Statistics() {
         if(pressed == 0) {
             return main_menu_state;
         }
-        LCD.Update();
+        LCD.WaitForInput();
     }
 }
 
@@ -1862,7 +1699,7 @@ int Instructions() {
         if(pressed == 0) {
             return main_menu_state;
         }
-        LCD.Update();
+        LCD.WaitForInput();
     }
 }
 
@@ -1914,11 +1751,17 @@ int main(){
     // initialize session timer
     session_start_time = TimeNow();
     
+    // images from "make pack" are already decoded, any not in it are loaded from their files
+    FEHImage::OpenPack("assets.pack");
+    FEHImage::SetCacheBudget(image_cache_budget);
     LoadMainMenuImage();
     LoadGameImages();
     LoadWorldImages();
     int current_state = main_menu_state;
     while(game_on == 1){
+        if(current_state != main_menu_state){
+            FinishLoadingImages();
+        }
         if(current_state == main_menu_state){
             current_state = MainMenu();
         } else {
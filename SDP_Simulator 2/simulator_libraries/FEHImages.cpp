@@ -6,8 +6,751 @@
 
 #include <FEHImages.h>
 #include "FEHUtility.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Asset pack layout, all numbers in the byte order of the machine that wrote it:
+// a PackHeader, count PackEntry records, then each image's pixels (tigr RGBA),
+// row run starts, runs and premultiplied blend pixels, every block 16 byte aligned.
+#define PACK_MAGIC "FEHPACK"
+#define PACK_VERSION 1
+#define PACK_ALIGN 16
+
+// Most threads OpenAsync() decodes images on
+#define IMAGE_LOADER_THREADS 4
+
+struct PackHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t count;
+	uint32_t runSize;   ///< sizeof(FEHImage::Run) when written
+	uint32_t blendSize; ///< sizeof(FEHImage::BlendPixel) when written
+};
+
+struct PackEntry
+{
+	char name[120];
+	uint32_t w, h;
+	uint32_t runCount, blendCount;
+	int64_t sourceTime, sourceSize; ///< Modification time and size of the image file that was packed
+	uint64_t pixels, rowRuns, runs, blendPixels; ///< Offsets from the start of the pack
+};
+
+// The pack opened with FEHImage::OpenPack, mapped for the rest of the program
+static const char *packData = NULL;
+static size_t packSize = 0;
+static const PackEntry *packEntries = NULL;
+static std::vector<Tigr> packBitmaps; ///< One bitmap per entry, its pixels point into the pack
+
+// Takes ownership of a bitmap, it is freed when the last image using it lets go
+static std::shared_ptr<Tigr> OwnBitmap(Tigr *bitmap)
+{
+	if (!bitmap)
+		return std::shared_ptr<Tigr>();
+	return std::shared_ptr<Tigr>(bitmap, tigrFree);
+}
+
+// Maps a whole file into memory, copy-on-write so a bitmap in it can still be drawn on
+static const char *MapFile(const char *filename, size_t *size)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	LARGE_INTEGER length;
+	HANDLE mapping = NULL;
+	void *data = NULL;
+	if (GetFileSizeEx(file, &length) && length.QuadPart > 0)
+	{
+		mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	}
+	if (mapping)
+	{
+		data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+
+	*size = data ? (size_t)length.QuadPart : 0;
+	return (const char *)data;
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0)
+		return NULL;
+
+	struct stat info;
+	void *data = MAP_FAILED;
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		data = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	}
+	close(file);
+
+	if (data == MAP_FAILED)
+		return NULL;
+	*size = info.st_size;
+	return (const char *)data;
+#endif
+}
+
+static void UnmapFile(const char *data, size_t size)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	munmap((void *)data, size);
+#endif
+}
+
+// Modification time and size of a file, false if it does not exist
+static bool SourceInfo(const char *filename, int64_t *time, int64_t *size)
+{
+	struct stat info;
+	if (stat(filename, &info) != 0)
+		return false;
+	*time = info.st_mtime;
+	*size = info.st_size;
+	return true;
+}
+
+// Checks that every block of an entry lies inside the pack, and that its run
+// tables only point inside the entry, since drawing indexes through them unchecked
+template <class Run>
+static bool EntryInPack(const PackEntry &entry, size_t blendSize)
+{
+	uint64_t pixels = (uint64_t)entry.w * entry.h;
+	bool inPack = entry.name[sizeof(entry.name) - 1] == '\0'
+		&& entry.w > 0 && entry.h > 0
+		&& entry.pixels + pixels * sizeof(TPixel) <= packSize
+		&& entry.rowRuns + ((uint64_t)entry.h + 1) * sizeof(int) <= packSize
+		&& entry.runs + (uint64_t)entry.runCount * sizeof(Run) <= packSize
+		&& entry.blendPixels + (uint64_t)entry.blendCount * blendSize <= packSize
+		&& (entry.pixels | entry.rowRuns | entry.runs | entry.blendPixels) % PACK_ALIGN == 0;
+	if (!inPack)
+		return false;
+
+	// Row starts go from the first run to runCount without going back
+	const int *rowRuns = (const int *)(packData + entry.rowRuns);
+	int previous = 0;
+	for (uint32_t y = 0; y <= entry.h; y++)
+	{
+		if (rowRuns[y] < previous || (uint32_t)rowRuns[y] > entry.runCount)
+			return false;
+		previous = rowRuns[y];
+	}
+
+	const Run *runs = (const Run *)(packData + entry.runs);
+	for (uint32_t i = 0; i < entry.runCount; i++)
+	{
+		const Run &run = runs[i];
+		if ((uint32_t)run.x + run.length > entry.w)
+			return false;
+		if (!run.opaque && (run.blendIndex < 0 || (uint64_t)run.blendIndex + run.length > entry.blendCount))
+			return false;
+	}
+	return true;
+}
+
+bool FEHImage::OpenPack(const char *filename)
+{
+	size_t size;
+	const char *data = MapFile(filename, &size);
+	if (!data)
+	{
+		// No pack is fine, every image is loaded from its file
+		return false;
+	}
+
+	if (packData)
+	{
+		// Images from the old pack point into it, so it stays mapped
+		std::cout << CONSOLE_ERR("Asset pack [" << CONSOLE_BLUE(filename) << "] not opened, a pack is already open.\n");
+		UnmapFile(data, size);
+		return false;
+	}
+
+	const PackHeader *header = (const PackHeader *)data;
+	bool valid = size >= sizeof(PackHeader)
+		&& memcmp(header->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0
+		&& header->version == PACK_VERSION
+		&& header->runSize == sizeof(Run)
+		&& header->blendSize == sizeof(BlendPixel)
+		&& sizeof(PackHeader) + (uint64_t)header->count * sizeof(PackEntry) <= size;
+
+	packData = data;
+	packSize = size;
+	packEntries = (const PackEntry *)(data + sizeof(PackHeader));
+	for (uint32_t i = 0; valid && i < header->count; i++)
+	{
+		valid = EntryInPack<Run>(packEntries[i], sizeof(BlendPixel));
+	}
+
+	if (!valid)
+	{
+		std::cout << CONSOLE_ERR("Asset pack [" << CONSOLE_BLUE(filename) << "] is not valid, run " << CONSOLE_GREEN("make pack") << " again. Loading images from their files.\n");
+		UnmapFile(data, size);
+		packData = NULL;
+		packSize = 0;
+		packEntries = NULL;
+		return false;
+	}
+
+	packBitmaps.resize(header->count);
+	for (uint32_t i = 0; i < header->count; i++)
+	{
+		packBitmaps[i].w = packEntries[i].w;
+		packBitmaps[i].h = packEntries[i].h;
+		packBitmaps[i].pix = (TPixel *)(data + packEntries[i].pixels);
+		packBitmaps[i].handle = NULL;
+	}
+
+	return true;
+}
+
+bool FEHImage::OpenFromPack(const char *filename)
+{
+	for (size_t i = 0; i < packBitmaps.size(); i++)
+	{
+		const PackEntry &entry = packEntries[i];
+		if (strcmp(entry.name, filename) != 0)
+			continue;
+
+		// An image edited since the pack was made is loaded from its file
+		int64_t time, size;
+		if (SourceInfo(filename, &time, &size) && (time != entry.sourceTime || size != entry.sourceSize))
+			return false;
+
+		// The pack stays mapped, so its bitmaps are never freed
+		tigr = std::shared_ptr<Tigr>(&packBitmaps[i], [](Tigr *) {});
+		width = tigr->w;
+		height = tigr->h;
+		sourceOffset = 0;
+		sharedBitmap = true;
+		runs.clear();
+		rowRuns.clear();
+		blendPixels.clear();
+		packRowRuns = (const int *)(packData + entry.rowRuns);
+		packRuns = (const Run *)(packData + entry.runs);
+		packBlendPixels = (const BlendPixel *)(packData + entry.blendPixels);
+		return true;
+	}
+
+	return false;
+}
+
+// Writes count bytes at offset and pads the file to the next PACK_ALIGN boundary
+static bool WriteAligned(FILE *file, const void *data, size_t count, uint64_t *offset)
+{
+	static const char zeros[PACK_ALIGN] = {0};
+	size_t padding = (PACK_ALIGN - (*offset + count) % PACK_ALIGN) % PACK_ALIGN;
+	if (fwrite(data, 1, count, file) != count || fwrite(zeros, 1, padding, file) != padding)
+		return false;
+	*offset += count + padding;
+	return true;
+}
+
+bool FEHImage::WritePack(const char *filename, const std::vector<std::string> &images)
+{
+	std::vector<PackEntry> entries(images.size());
+	std::vector<FEHImage> decoded(images.size());
+
+	// Decode everything first, so the data offsets are known before the index is written
+	bool ok = true;
+	uint64_t offset = sizeof(PackHeader) + entries.size() * sizeof(PackEntry);
+	offset += (PACK_ALIGN - offset % PACK_ALIGN) % PACK_ALIGN;
+	for (size_t i = 0; ok && i < images.size(); i++)
+	{
+		PackEntry &entry = entries[i];
+		FEHImage &image = decoded[i];
+		memset(&entry, 0, sizeof(entry));
+
+		if (images[i].size() >= sizeof(entry.name))
+		{
+			std::cout << CONSOLE_ERR("Image name [" << CONSOLE_BLUE(images[i]) << "] is too long for an asset pack.\n");
+			ok = false;
+			break;
+		}
+		image.Open(images[i].c_str());
+		if (!image.tigr || !SourceInfo(images[i].c_str(), &entry.sourceTime, &entry.sourceSize))
+		{
+			ok = false;
+			break;
+		}
+
+		strcpy(entry.name, images[i].c_str());
+		entry.w = image.tigr->w;
+		entry.h = image.tigr->h;
+		entry.runCount = image.runs.size();
+		entry.blendCount = image.blendPixels.size();
+
+		entry.pixels = offset;
+		offset += (uint64_t)entry.w * entry.h * sizeof(TPixel);
+		offset += (PACK_ALIGN - offset % PACK_ALIGN) % PACK_ALIGN;
+		entry.rowRuns = offset;
+		offset += image.rowRuns.size() * sizeof(int);
+		offset += (PACK_ALIGN - offset % PACK_ALIGN) % PACK_ALIGN;
+		entry.runs = offset;
+		offset += image.runs.size() * sizeof(Run);
+		offset += (PACK_ALIGN - offset % PACK_ALIGN) % PACK_ALIGN;
+		entry.blendPixels = offset;
+		offset += image.blendPixels.size() * sizeof(BlendPixel);
+		offset += (PACK_ALIGN - offset % PACK_ALIGN) % PACK_ALIGN;
+	}
+
+	FILE *file = ok ? fopen(filename, "wb") : NULL;
+	if (ok && !file)
+	{
+		std::cout << CONSOLE_ERR("Asset pack [" << CONSOLE_BLUE(filename) << "] could not be written.\n");
+		ok = false;
+	}
+
+	PackHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+	header.version = PACK_VERSION;
+	header.count = entries.size();
+	header.runSize = sizeof(Run);
+	header.blendSize = sizeof(BlendPixel);
+
+	uint64_t written = 0;
+	if (file)
+	{
+		ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		written += sizeof(header);
+		ok = ok && WriteAligned(file, entries.data(), entries.size() * sizeof(PackEntry), &written);
+		for (size_t i = 0; ok && i < decoded.size(); i++)
+		{
+			const FEHImage &image = decoded[i];
+
+			// Runs copied field by field into zero-initialized ones, so their padding bytes are the same every time
+			std::vector<Run> runs(image.runs.size());
+			for (size_t j = 0; j < runs.size(); j++)
+			{
+				runs[j].x = image.runs[j].x;
+				runs[j].length = image.runs[j].length;
+				runs[j].opaque = image.runs[j].opaque;
+				runs[j].blendIndex = image.runs[j].blendIndex;
+			}
+
+			ok = WriteAligned(file, image.tigr->pix, (size_t)image.tigr->w * image.tigr->h * sizeof(TPixel), &written)
+				&& WriteAligned(file, image.rowRuns.data(), image.rowRuns.size() * sizeof(int), &written)
+				&& WriteAligned(file, runs.data(), runs.size() * sizeof(Run), &written)
+				&& WriteAligned(file, image.blendPixels.data(), image.blendPixels.size() * sizeof(BlendPixel), &written);
+		}
+		ok = fclose(file) == 0 && ok && written == offset;
+
+		if (!ok)
+		{
+			std::cout << CONSOLE_ERR("Asset pack [" << CONSOLE_BLUE(filename) << "] could not be written.\n");
+			remove(filename);
+		}
+	}
+
+	return ok;
+}
+
+// An image's trimmed pixels and where they go in an atlas
+struct AtlasRect
+{
+	FEHImage *image;
+	int left, top, w, h; ///< Part of the image that is not fully transparent
+	int x, y;            ///< Position in the atlas
+};
+
+static bool TallerFirst(const AtlasRect &a, const AtlasRect &b)
+{
+	return a.h != b.h ? a.h > b.h : a.w > b.w;
+}
+
+// Places the rects on shelves, tallest first, in an atlas atlasWidth wide, returns the atlas height
+static int PlaceOnShelves(std::vector<AtlasRect> &rects, int atlasWidth)
+{
+	int shelfX = 0, shelfY = 0, shelfHeight = 0;
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		if (shelfX + rects[i].w > atlasWidth)
+		{
+			shelfX = 0;
+			shelfY += shelfHeight;
+			shelfHeight = 0;
+		}
+		rects[i].x = shelfX;
+		rects[i].y = shelfY;
+		shelfX += rects[i].w;
+		if (rects[i].h > shelfHeight)
+		{
+			shelfHeight = rects[i].h;
+		}
+	}
+	return shelfY + shelfHeight;
+}
+
+void FEHImage::PackAtlas(FEHImage *const images[], int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (images[i])
+			images[i]->Wait();
+	}
+
+	// Find the part of every image that is not fully transparent, Draw() never reads the rest
+	std::vector<AtlasRect> rects;
+	int widest = 0, totalWidth = 0;
+	for (int i = 0; i < count; i++)
+	{
+		FEHImage *image = images[i];
+		bool repeated = false;
+		for (size_t j = 0; j < rects.size(); j++)
+		{
+			repeated = repeated || rects[j].image == image;
+		}
+		if (!image || !image->tigr || repeated)
+			continue;
+
+		AtlasRect rect;
+		rect.image = image;
+		rect.left = image->width;
+		rect.top = image->height;
+		int right = 0, bottom = 0;
+		const int *rowStart = image->packRowRuns ? image->packRowRuns : image->rowRuns.data();
+		const Run *runList = image->packRuns ? image->packRuns : image->runs.data();
+		for (int row = 0; row < image->height; row++)
+		{
+			for (int j = rowStart[row]; j < rowStart[row + 1]; j++)
+			{
+				rect.left = std::min(rect.left, (int)runList[j].x);
+				right = std::max(right, runList[j].x + runList[j].length);
+				rect.top = std::min(rect.top, row);
+				bottom = row + 1;
+			}
+		}
+		rect.w = std::max(right - rect.left, 0);
+		rect.h = std::max(bottom - rect.top, 0);
+		widest = std::max(widest, rect.w);
+		totalWidth += rect.w;
+		rects.push_back(rect);
+	}
+	if (rects.empty())
+		return;
+
+	// Try every width from the widest image to one shelf, keep the one that wastes the least
+	std::sort(rects.begin(), rects.end(), TallerFirst);
+	int bestWidth = 0, bestHeight = 0;
+	for (int atlasWidth = std::max(widest, 1); atlasWidth <= std::max(totalWidth, 1); atlasWidth++)
+	{
+		int atlasHeight = PlaceOnShelves(rects, atlasWidth);
+		if (bestWidth == 0 || atlasWidth * atlasHeight < bestWidth * bestHeight)
+		{
+			bestWidth = atlasWidth;
+			bestHeight = atlasHeight;
+		}
+	}
+	PlaceOnShelves(rects, bestWidth);
+
+	std::shared_ptr<Tigr> atlas = OwnBitmap(tigrBitmap(std::max(bestWidth, 1), std::max(bestHeight, 1)));
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		const AtlasRect &rect = rects[i];
+		FEHImage *image = rect.image;
+		for (int row = 0; row < rect.h; row++)
+		{
+			memcpy(&atlas->pix[(rect.y + row) * atlas->w + rect.x],
+				   &image->tigr->pix[(rect.top + row) * image->tigr->w + rect.left + image->sourceOffset],
+				   rect.w * sizeof(TPixel));
+		}
+
+		// The image's own bitmap is freed here, unless a copy of the image still uses it
+		image->tigr = atlas;
+		image->sourceOffset = (rect.y - rect.top) * atlas->w + rect.x - rect.left;
+		image->sharedBitmap = true;
+	}
+}
+
+// Decodes images for FEHImage::OpenAsync on a pool of threads, in the order they were queued
+class ImageLoader
+{
+	public:
+		~ImageLoader();
+
+		/// @brief Queue a file to decode, starts the threads on first use
+		std::shared_future<std::shared_ptr<FEHImage>> Queue(const char *filename);
+
+	private:
+		struct Job
+		{
+			std::string filename;
+			std::promise<std::shared_ptr<FEHImage>> done;
+		};
+
+		void Work();
+
+		std::mutex lock;
+		std::condition_variable wake;
+		std::deque<Job> jobs;
+		std::vector<std::thread> threads;
+		bool stopping = false;
+};
+
+static ImageLoader imageLoader;
+
+std::shared_future<std::shared_ptr<FEHImage>> ImageLoader::Queue(const char *filename)
+{
+	Job job;
+	job.filename = filename;
+	std::shared_future<std::shared_ptr<FEHImage>> result = job.done.get_future().share();
+
+	std::lock_guard<std::mutex> guard(lock);
+	if (threads.empty())
+	{
+		// Leave a core for the program itself
+		int count = (int)std::thread::hardware_concurrency() - 1;
+		count = std::min(std::max(count, 1), IMAGE_LOADER_THREADS);
+		for (int i = 0; i < count; i++)
+		{
+			threads.push_back(std::thread(&ImageLoader::Work, this));
+		}
+	}
+	jobs.push_back(std::move(job));
+	wake.notify_one();
+	return result;
+}
+
+void ImageLoader::Work()
+{
+	while (true)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [this] { return stopping || !jobs.empty(); });
+			if (stopping)
+				return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		std::shared_ptr<FEHImage> image = std::make_shared<FEHImage>();
+		image->OpenFile(job.filename.c_str());
+		job.done.set_value(image);
+	}
+}
+
+// Images still queued when the program exits are dropped, nothing can draw them any more
+ImageLoader::~ImageLoader()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+}
+
+// Decoded images of FEHImage::OpenLazy, by file name, freed least recently drawn first when over budget.
+// Only used from the thread that draws, so it takes no locks.
+class ImageCache
+{
+	public:
+		/// @brief Get the decoded image of a file, decoding it if it is not in the cache
+		std::shared_ptr<FEHImage> Get(const std::string &filename);
+
+		void SetBudget(size_t bytes);
+		FEHImageCacheStats Stats() const;
+
+	private:
+		struct Entry
+		{
+			std::shared_ptr<FEHImage> image;
+			size_t bytes;
+			std::list<std::string>::iterator use; ///< Position in order
+		};
+
+		/// @brief Free images, least recently drawn first, until the cache is under budget
+		void Evict(const std::string &keep);
+
+		std::unordered_map<std::string, Entry> entries;
+		std::list<std::string> order; ///< Most recently drawn first
+		size_t budget = IMAGE_CACHE_BUDGET;
+		size_t resident = 0;
+		unsigned long hits = 0, misses = 0, evictions = 0;
+};
+
+static ImageCache imageCache;
+
+std::shared_ptr<FEHImage> ImageCache::Get(const std::string &filename)
+{
+	std::unordered_map<std::string, Entry>::iterator found = entries.find(filename);
+	if (found != entries.end())
+	{
+		hits++;
+		order.splice(order.begin(), order, found->second.use);
+		return found->second.image;
+	}
+
+	misses++;
+	Entry entry;
+	entry.image = std::make_shared<FEHImage>();
+	entry.image->Open(filename.c_str());
+	entry.bytes = entry.image->ResidentBytes();
+	order.push_front(filename);
+	entry.use = order.begin();
+	entries[filename] = entry;
+	resident += entry.bytes;
+
+	Evict(filename);
+	return entry.image;
+}
+
+void ImageCache::Evict(const std::string &keep)
+{
+	std::list<std::string>::iterator use = order.end();
+	while (resident > budget && use != order.begin())
+	{
+		--use;
+		Entry &entry = entries[*use];
+
+		// Freeing an image something else still holds would not free any memory
+		if (*use == keep || entry.image.use_count() > 1)
+			continue;
+
+		resident -= entry.bytes;
+		evictions++;
+		entries.erase(*use);
+		use = order.erase(use);
+	}
+}
+
+void ImageCache::SetBudget(size_t bytes)
+{
+	budget = bytes;
+	Evict(std::string());
+}
+
+FEHImageCacheStats ImageCache::Stats() const
+{
+	FEHImageCacheStats stats;
+	stats.hits = hits;
+	stats.misses = misses;
+	stats.evictions = evictions;
+	stats.residentBytes = resident;
+	stats.budgetBytes = budget;
+	stats.images = entries.size();
+	return stats;
+}
+
+void FEHImage::SetCacheBudget(size_t bytes)
+{
+	imageCache.SetBudget(bytes);
+}
+
+FEHImageCacheStats FEHImage::GetCacheStats()
+{
+	return imageCache.Stats();
+}
+
+size_t FEHImage::ResidentBytes() const
+{
+	size_t bytes = runs.capacity() * sizeof(Run) + rowRuns.capacity() * sizeof(int) + blendPixels.capacity() * sizeof(BlendPixel);
+	if (tigr && !sharedBitmap)
+	{
+		bytes += (size_t)tigr->w * tigr->h * sizeof(TPixel);
+	}
+	return bytes;
+}
+
+void FEHImage::OpenLazy(const char *filename)
+{
+	Close();
+	cachePath = filename;
+}
+
+void FEHImage::Close()
+{
+	tigr.reset();
+	width = height = 0;
+	sourceOffset = 0;
+	sharedBitmap = false;
+	runs.clear();
+	rowRuns.clear();
+	blendPixels.clear();
+	packRowRuns = NULL;
+	packRuns = NULL;
+	packBlendPixels = NULL;
+	loading = std::shared_future<std::shared_ptr<FEHImage>>();
+	cachePath.clear();
+}
+
+void FEHImage::OpenAsync(const char *filename)
+{
+	Close();
+
+	// Images in the asset pack are ready straight away
+	if (packData && OpenFromPack(filename))
+	{
+		return;
+	}
+
+	loading = imageLoader.Queue(filename);
+}
+
+bool FEHImage::IsReady()
+{
+	if (!loading.valid())
+	{
+		return true;
+	}
+	if (loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return false;
+	}
+
+	// Take over the decoded image, the loader's copy is freed with the future
+	std::shared_ptr<FEHImage> loaded = loading.get();
+	*this = *loaded;
+	return true;
+}
+
+void FEHImage::Wait()
+{
+	if (loading.valid())
+	{
+		loading.wait();
+		IsReady();
+	}
+}
 
 void FEHImage::Open(const char *filename)
+{
+	Close();
+
+	// Images in the asset pack are already decoded
+	if (packData && OpenFromPack(filename))
+	{
+		return;
+	}
+
+	OpenFile(filename);
+}
+
+void FEHImage::OpenFile(const char *filename)
 {
 	// Check file extension, if it is a .pic file, use OpenPic
 	if (strstr(filename, ".pic") != NULL || strstr(filename, ".PIC") != NULL)
@@ -18,7 +761,7 @@ void FEHImage::Open(const char *filename)
 	else if (strstr(filename, ".png") != NULL || strstr(filename, ".PNG") != NULL)
 	{
 		// Load image from file
-		tigr = tigrLoadImage(filename);
+		tigr = OwnBitmap(tigrLoadImage(filename));
 		if (!tigr)
 		{
 			std::cout << CONSOLE_ERR("File [" << CONSOLE_BLUE(filename) << "] failed to open! Please check if it exists and is in the correct directory.\n");
@@ -36,6 +779,60 @@ void FEHImage::Open(const char *filename)
 	{
 		std::cout << CONSOLE_ERR("Image [" << CONSOLE_BLUE(filename) << "] is too large! Please use an image smaller than " << CONSOLE_GREEN(LCD_WIDTH) << "x" << CONSOLE_GREEN(LCD_HEIGHT) << "\n");
 	}
+
+	width = tigr->w;
+	height = tigr->h;
+	sourceOffset = 0;
+	sharedBitmap = false;
+	BuildRuns();
+}
+
+// Splits every row into runs once, so Draw() only blends the pixels that need it.
+// A partly transparent pixel is stored premultiplied, with the same 0-256 alpha
+// tigrBlitAlpha uses, so drawing gives exactly the same pixels.
+void FEHImage::BuildRuns()
+{
+	runs.clear();
+	rowRuns.assign(tigr->h + 1, 0);
+	blendPixels.clear();
+
+	for (int y = 0; y < tigr->h; y++)
+	{
+		rowRuns[y] = runs.size();
+		const TPixel *row = &tigr->pix[y * tigr->w];
+		int x = 0;
+		while (x < tigr->w)
+		{
+			if (row[x].a == 0)
+			{
+				x++;
+				continue;
+			}
+
+			Run run;
+			run.x = x;
+			run.opaque = row[x].a == 255;
+			run.blendIndex = run.opaque ? -1 : blendPixels.size();
+			while (x < tigr->w && row[x].a != 0 && (row[x].a == 255) == run.opaque)
+			{
+				if (!run.opaque)
+				{
+					int alpha = row[x].a + 1; // 1-255 expanded to 2-256, as in tigr
+					BlendPixel pixel;
+					pixel.r = row[x].r * alpha;
+					pixel.g = row[x].g * alpha;
+					pixel.b = row[x].b * alpha;
+					pixel.a = row[x].a * alpha;
+					pixel.inverse = 256 - alpha;
+					blendPixels.push_back(pixel);
+				}
+				x++;
+			}
+			run.length = x - run.x;
+			runs.push_back(run);
+		}
+	}
+	rowRuns[tigr->h] = runs.size();
 }
 
 // Legacy function to load .pic files
@@ -57,7 +854,7 @@ void FEHImage::OpenPic(const char *filename)
 	else
 		std::cout << "File: " << filename << " did not open!\n";
 
-	tigr = tigrBitmap(w, h);
+	tigr = OwnBitmap(tigrBitmap(w, h));
 
 	unsigned int tmp_c;
 
@@ -78,10 +875,122 @@ void FEHImage::OpenPic(const char *filename)
 // x,y are top left location of where to draw picture
 void FEHImage::Draw(int x, int y)
 {
+	if (!cachePath.empty())
+	{
+		// Held until drawn, so the cache cannot free it in between
+		std::shared_ptr<FEHImage> image = imageCache.Get(cachePath);
+		image->Draw(x, y);
+		return;
+	}
+
+	DrawRegion(x, y, 0, 0, width, height);
+}
+
+// Draws image columns left to left + w - 1 and rows top to top + h - 1 with their top left at x,y
+void FEHImage::DrawRegion(int x, int y, int left, int top, int w, int h)
+{
+	if (!cachePath.empty())
+	{
+		std::shared_ptr<FEHImage> image = imageCache.Get(cachePath);
+		image->DrawRegion(x, y, left, top, w, h);
+		return;
+	}
+
+	if (!IsReady())
+	{
+		// Still loading, draw nothing until it is ready
+		return;
+	}
+
 	if (tigr)
 	{
-		// Draw image to LCD
-		tigrBlitAlpha(LCD.screen, tigr, x, y, 0, 0, tigr->w, tigr->h, 1.0);
+		Tigr *screen = LCD.screen;
+		const int *rowStart = packRowRuns ? packRowRuns : rowRuns.data();
+		const Run *runList = packRuns ? packRuns : runs.data();
+		const BlendPixel *blendList = packBlendPixels ? packBlendPixels : blendPixels.data();
+
+		// Clip the part to the image
+		if (left < 0)
+		{
+			x -= left;
+			w += left;
+			left = 0;
+		}
+		if (top < 0)
+		{
+			y -= top;
+			h += top;
+			top = 0;
+		}
+		if (left + w > width)
+		{
+			w = width - left;
+		}
+		if (top + h > height)
+		{
+			h = height - top;
+		}
+		if (w <= 0 || h <= 0)
+		{
+			return;
+		}
+
+		// Image column col is drawn at screen column col + dx, likewise for rows
+		int dx = x - left;
+		int dy = y - top;
+
+		// Rows of the image that are in the part and on the screen
+		int firstRow = dy < 0 ? -dy : 0;
+		int lastRow = dy + top + h > screen->h ? screen->h - dy : top + h;
+		if (firstRow < top)
+		{
+			firstRow = top;
+		}
+
+		// Columns of the image that are in the part and on the screen
+		int firstColumn = dx < 0 ? -dx : 0;
+		int lastColumn = dx + left + w > screen->w ? screen->w - dx : left + w;
+		if (firstColumn < left)
+		{
+			firstColumn = left;
+		}
+
+		for (int row = firstRow; row < lastRow; row++)
+		{
+			TPixel *dst = &screen->pix[(dy + row) * screen->w];
+			int src = row * tigr->w + sourceOffset;
+			for (int i = rowStart[row]; i < rowStart[row + 1]; i++)
+			{
+				const Run &run = runList[i];
+
+				// Clip the run to the part and the screen
+				int start = run.x < firstColumn ? firstColumn : run.x;
+				int end = run.x + run.length > lastColumn ? lastColumn : run.x + run.length;
+				if (start >= end)
+				{
+					continue;
+				}
+
+				if (run.opaque)
+				{
+					memcpy(&dst[dx + start], &tigr->pix[src + start], (end - start) * sizeof(TPixel));
+				}
+				else
+				{
+					const BlendPixel *pixel = &blendList[run.blendIndex + start - run.x];
+					for (int j = start; j < end; j++, pixel++)
+					{
+						TPixel &d = dst[dx + j];
+						d.r = (pixel->r + d.r * pixel->inverse) >> 8;
+						d.g = (pixel->g + d.g * pixel->inverse) >> 8;
+						d.b = (pixel->b + d.b * pixel->inverse) >> 8;
+						d.a = (pixel->a + d.a * pixel->inverse) >> 8;
+					}
+				}
+			}
+		}
+
+		LCD._Damage(x, y, w, h);
 	}
 	else
 	{
@@ -3,10 +3,29 @@
 #include <fstream>
 #include <iostream>
 #include <tigr.h>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <future>
+#include <memory>
 
 #ifndef FEHIMAGES_H
 #define FEHIMAGES_H
 
+// Default memory budget of the image cache in bytes, see FEHImage::SetCacheBudget()
+#define IMAGE_CACHE_BUDGET (16 * 1024 * 1024)
+
+/// @brief Image cache counters, see FEHImage::GetCacheStats()
+struct FEHImageCacheStats
+{
+	unsigned long hits;      ///< Draws of a lazy image that was still decoded
+	unsigned long misses;    ///< Draws that had to decode the file first
+	unsigned long evictions; ///< Images freed to stay under the budget
+	size_t residentBytes;    ///< Memory used by decoded images in the cache
+	size_t budgetBytes;      ///< Memory the cache tries to stay under
+	int images;              ///< Images in the cache
+};
+
 /// @brief Class for loading and drawing images
 class FEHImage
 {
@@ -22,20 +41,118 @@ class FEHImage
 		/// @param filename The name of the file to open. Must end in .png or (legacy) .pic 
 		void Open(const char * filename);
 
+		/// @brief Start opening an image file in the background, so the program can keep drawing
+		/// @param filename The name of the file to open. Must end in .png or (legacy) .pic
+		/// @note Draw() does nothing until the image is ready, see IsReady() and Wait()
+		void OpenAsync(const char * filename);
+
+		/// @brief Open an image file the first time it is drawn, through the image cache
+		/// @param filename The name of the file to open. Must end in .png or (legacy) .pic
+		/// @note Images of the same file share one decoded copy. When the cache is over its budget,
+		/// the images drawn longest ago are freed, and decoded again when they are next drawn.
+		void OpenLazy(const char * filename);
+
+		/// @brief Check if an image opened with OpenAsync() has finished loading
+		/// @return true once the image can be drawn, or if it was opened with Open()
+		bool IsReady();
+
+		/// @brief Wait for an image opened with OpenAsync() to finish loading
+		void Wait();
+
 		/// @brief Draw the image at the specified location
 		/// @param x X coordinate of upper left corner of image
 		/// @param y Y coordinate of upper left corner of image
 		void Draw(int x, int y);
 
-		/// @brief (LEGACY) Close the image file
-		/// @deprecated This function is no longer necessary, do not use
-		void Close() {}
+		/// @brief Draw part of the image
+		/// @param x X coordinate the upper left corner of the part is drawn at
+		/// @param y Y coordinate the upper left corner of the part is drawn at
+		/// @param left Left edge of the part, in image pixels
+		/// @param top Top edge of the part, in image pixels
+		/// @param width Width of the part
+		/// @param height Height of the part
+		void DrawRegion(int x, int y, int left, int top, int width, int height);
+
+		/// @brief Close the image, freeing its pixels unless another image shares them
+		void Close();
+
+		/// @brief Set how much memory the images opened with OpenLazy() may use
+		/// @param bytes Memory budget in bytes, IMAGE_CACHE_BUDGET by default
+		static void SetCacheBudget(size_t bytes);
+
+		/// @brief Get the image cache counters
+		static FEHImageCacheStats GetCacheStats();
+
+		/// @brief Open an asset pack made by "make pack", Open() then takes images from it instead of decoding files
+		/// @param filename The name of the pack file
+		/// @return true if the pack was opened, false if it does not exist or is not a valid pack
+		/// @note An image whose file has changed since the pack was made is still loaded from the file
+		static bool OpenPack(const char *filename);
+
+		/// @brief Decode images and write them to an asset pack, see tools/pack.cpp
+		/// @param filename The name of the pack file to write
+		/// @param images Names of the image files, as the program will pass them to Open()
+		/// @return true if every image was written
+		static bool WritePack(const char *filename, const std::vector<std::string> &images);
+
+		/// @brief Move opened images into one shared bitmap (a texture atlas), trimmed of transparent edges
+		/// @param images Images to move, ones that are not open are skipped
+		/// @param count Number of images
+		/// @note The images draw exactly as before, from one block of memory instead of one per image
+		static void PackAtlas(FEHImage *const images[], int count);
 	private:
+		friend class ImageLoader;
+		friend class ImageCache;
+
+		/// @brief Memory used by the decoded image, not counting an asset pack or atlas it points into
+		size_t ResidentBytes() const;
+
+		/// @brief Decode an image file, the part of Open() that OpenAsync() runs on a loader thread
+		void OpenFile(const char *filename);
 
 		/// @brief Open a .pic file
 		void OpenPic(const char *);
 
-		Tigr *tigr;
+		/// @brief Build the run table and premultiplied pixels from tigr
+		void BuildRuns();
+
+		/// @brief Point this image at an image in the open asset pack
+		/// @return false if the pack does not hold an up to date copy of the file
+		bool OpenFromPack(const char *filename);
+
+		/// @brief A span of pixels in one row that are all opaque or all partly transparent
+		/// @note Fully transparent pixels are not in any run, Draw() skips them
+		/// @note Fixed size fields, since asset packs store runs as they are in memory
+		struct Run
+		{
+			uint16_t x;
+			uint16_t length;
+			uint8_t opaque;
+			int32_t blendIndex; ///< First pixel in blendPixels, partly transparent runs only
+		};
+
+		/// @brief A partly transparent pixel, premultiplied by its alpha
+		/// @note Drawn as (color + screen * inverse) >> 8, the same result as tigrBlitAlpha
+		struct BlendPixel
+		{
+			unsigned short r, g, b, a;
+			unsigned short inverse;
+		};
+
+		std::shared_ptr<Tigr> tigr; ///< Shared by copies of the image, and by every image in an atlas
+		int width = 0, height = 0; ///< Size of the image, tigr may be larger (an atlas) or smaller (trimmed)
+		int sourceOffset = 0;      ///< Pixel (x, y) of the image is tigr->pix[y * tigr->w + x + sourceOffset]
+		bool sharedBitmap = false; ///< tigr belongs to an asset pack or an atlas, not to this image
+		std::shared_future<std::shared_ptr<FEHImage>> loading; ///< The image being decoded by OpenAsync()
+		std::string cachePath; ///< File of an image opened with OpenLazy(), its pixels live in the image cache
+		std::vector<Run> runs;
+		std::vector<int> rowRuns; ///< runs of row y are runs[rowRuns[y]] to runs[rowRuns[y + 1] - 1]
+		std::vector<BlendPixel> blendPixels;
+
+		/// @brief Tables of an image from the asset pack, used instead of the vectors above when set
+		const int *packRowRuns = NULL;
+		const Run *packRuns = NULL;
+		const BlendPixel *packBlendPixels = NULL;
 };
 
 #endif
@@ -6,6 +6,22 @@
 
 FEHKeyboard Keyboard;
 
+// Waits for the keyboard or screen to change, until timeout seconds after startTime (0 waits indefinitely)
+static void WaitForChange(double startTime, double timeout)
+{
+    if (timeout == 0)
+    {
+        LCD.WaitForInput();
+        return;
+    }
+
+    double left = timeout - (TimeNow() - startTime);
+    if (left > 0)
+    {
+        LCD.WaitForInput(left);
+    }
+}
+
 
 char FEHKeyboard::lastChar()
 {
@@ -31,11 +47,10 @@ bool FEHKeyboard::isPressed(Key key)
 
 bool FEHKeyboard::isPressed(const std::vector<Key>& keys)
 {
-    debugPrint();
+    KeyboardState keyboard = state();
     for (Key key : keys)
     {
-        printf("Key: %d\n", key);
-    if (!tigrKeyHeld(LCD.getScreen(), (char)key))
+        if (!keyboard.isHeld(key))
         {
             return false;
         }
@@ -45,40 +60,81 @@ bool FEHKeyboard::isPressed(const std::vector<Key>& keys)
 
 bool FEHKeyboard::areAnyPressed(const std::vector<Key>& keys)
 {
-    // Make AND-masks for each key set
-    std::vector<uint32_t> masks = makeMasks(keys);
+    if (keys.empty())
+    {
+        return areAnyPressed(ALL_KEYS);
+    }
+    return areAnyPressed(MakeKeySet(keys));
+}
+
+bool FEHKeyboard::areAnyPressed(const KeySet& keys)
+{
+    return state().anyHeld(keys);
+}
 
-    // Get entire keystates
-    std::vector<uint32_t> data = tigrKeyboardData(LCD.getScreen());
+KeyboardState FEHKeyboard::state()
+{
+    KeyboardState keyboard;
+    tigrKeyboardState(LCD.getScreen(), keyboard.held.bits, keyboard.previous.bits);
+    return keyboard;
+}
 
-    // Check if any keys are pressed
+KeySet MakeKeySet(const std::vector<Key>& keys)
+{
+    KeySet set;
+    for (Key key : keys)
+    {
+        AddKey(set, key);
+    }
+    return set;
+}
+
+bool KeyboardState::anyHeld(const KeySet& keys) const
+{
     for (int i = 0; i < 8; i++)
     {
-        if (data[i] & masks[i])
+        if (held.bits[i] & keys.bits[i])
         {
             return true;
         }
     }
-
     return false;
 }
 
-bool FEHKeyboard::areAnyPressed(std::vector<uint32_t>& masks)
+bool KeyboardState::allHeld(const std::initializer_list<Key>& keys) const
 {
-    // Get entire keystates
-    std::vector<uint32_t> data = tigrKeyboardData(LCD.getScreen());
+    for (Key key : keys)
+    {
+        if (!isHeld(key))
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
-    // Check if any keys are pressed
+bool KeyboardState::anyPressed(const KeySet& keys) const
+{
     for (int i = 0; i < 8; i++)
     {
-        if (data[i] & masks[i])
+        if (held.bits[i] & ~previous.bits[i] & keys.bits[i])
         {
             return true;
         }
     }
-
     return false;
+}
 
+bool KeyboardState::anyReleased(const KeySet& keys) const
+{
+    for (int i = 0; i < 8; i++)
+    {
+        if (~held.bits[i] & previous.bits[i] & keys.bits[i])
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
 
@@ -95,7 +151,7 @@ bool FEHKeyboard::waitAnyKey(double timeout)
         {
             return true;
         }
-    tigrUpdate(LCD.getScreen());
+        WaitForChange(startTime, timeout);
     }
 
     return false;
@@ -109,17 +165,17 @@ bool FEHKeyboard::waitAnyOfKeys(const std::vector<Key>& keys, double timeout)
     if (timeout < 0)
         return false;
 
-    std::vector<uint32_t> masks = makeMasks(keys);
+    KeySet set = keys.empty() ? ALL_KEYS : MakeKeySet(keys);
 
     while (timeout == 0 || TimeNow() - startTime < timeout)
     {
 
-        if (areAnyPressed(masks))
+        if (areAnyPressed(set))
         {
             return true;
         }
 
-    tigrUpdate(LCD.getScreen());
+        WaitForChange(startTime, timeout);
     }
 
     return false;
@@ -142,7 +198,7 @@ bool FEHKeyboard::waitSpecificKey(Key key, double timeout)
             return true;
         }
 
-        tigrUpdate(LCD.getScreen());
+        WaitForChange(startTime, timeout);
     }
 
     return false;
@@ -164,7 +220,7 @@ bool FEHKeyboard::waitSpecificKeys(const std::vector<Key>& keys, double timeout)
             return true;
         }
 
-    tigrUpdate(LCD.getScreen());
+        WaitForChange(startTime, timeout);
     }
 
     return false;
@@ -182,17 +238,15 @@ bool FEHKeyboard::waitNoKeys(double timeout)
         return false;
 
 
-    std::vector<uint32_t> masks = makeMasks();
-
     while (timeout == 0 || TimeNow() - startTime < timeout)
     {
 
-        if (!areAnyPressed(masks))
+        if (!areAnyPressed(ALL_KEYS))
         {
             return true;
         }
 
-    tigrUpdate(LCD.getScreen());
+        WaitForChange(startTime, timeout);
     }
 
     return false;
@@ -206,23 +260,23 @@ bool FEHKeyboard::waitNoKeysExcept(const std::vector<Key>& keys, double timeout)
     if (timeout < 0)
         return false;
 
-    std::vector<uint32_t> masks = makeMasks(keys);
+    KeySet set = MakeKeySet(keys);
 
-    // Invert masks
+    // Every key not in the list
     for (int i = 0; i < 8; i++)
     {
-        masks[i] = ~masks[i];
+        set.bits[i] = ~set.bits[i];
     }
 
     while (timeout == 0 || TimeNow() - startTime < timeout)
     {
 
-        if (!areAnyPressed(masks))
+        if (!areAnyPressed(set))
         {
             return true;
         }
 
-    tigrUpdate(LCD.getScreen());
+        WaitForChange(startTime, timeout);
     }
 
     return false;
@@ -231,57 +285,6 @@ bool FEHKeyboard::waitNoKeysExcept(const std::vector<Key>& keys, double timeout)
 
 
 
-std::vector<uint32_t> FEHKeyboard::makeMasks(const std::vector<Key>& keys)
-{
-    // Make AND-masks for each key set
-    std::vector<uint32_t> masks({0, 0, 0, 0, 0, 0, 0, 0});
-
-    if (keys.empty())
-    {
-        for (int i = 0; i < 8; i++)
-        {
-            masks[i] = 0xFFFFFFFF;
-        }
-    }
-    else{
-        for (Key key : keys)
-        {
-            auto addCode = [&masks](int code){
-                if (code >= 0 && code < 256) {
-                    int block = code / 32;
-                    int bit = code % 32;
-                    masks[block] |= (1u << bit);
-                }
-            };
-
-            switch (key) {
-                case KEY_SHIFT:
-                    addCode((int)TK_SHIFT);    // some platforms set TK_SHIFT
-                    addCode((int)TK_LSHIFT);
-                    addCode((int)TK_RSHIFT);
-                    break;
-                case KEY_CONTROL:
-                    addCode((int)TK_CONTROL);
-                    addCode((int)TK_LCONTROL);
-                    addCode((int)TK_RCONTROL);
-                    break;
-                case KEY_ALT:
-                    addCode((int)TK_ALT);
-                    addCode((int)TK_LALT);
-                    addCode((int)TK_RALT);
-                    break;
-                default:
-                    addCode((int)key);
-                    break;
-            }
-        }
-    }
-
-    return masks;
-}
-
-
-
 void FEHKeyboard::debugPrint()
 {
     std::vector<uint32_t> data = tigrKeyboardData(LCD.getScreen());
@@ -325,6 +328,20 @@ std::vector<int> FEHKeyboard::pressedScanCodes()
     return pressed;
 }
 
+bool FEHKeyboard::nextKeyEvent(KeyEvent *event)
+{
+    TigrEvent next;
+    if (!tigrPopKeyEvent(LCD.getScreen(), &next))
+    {
+        return false;
+    }
+
+    event->key = (Key)next.button;
+    event->pressed = next.type == TIGR_KEY_DOWN;
+    event->time = next.time;
+    return true;
+}
+
 std::vector<Key> FEHKeyboard::pressedKeys()
 {
     std::vector<Key> keys;
@@ -8,6 +8,7 @@
 #include "tigr.h"
 #include <FEHLCD.h>
 #include <vector>
+#include <initializer_list>
 
 
 #define ALPHABET_KEYSET KEY_A, KEY_B, KEY_C, KEY_D, KEY_E, KEY_F, KEY_G, KEY_H, KEY_I, KEY_J, KEY_K, KEY_L, KEY_M, KEY_N, KEY_O, KEY_P, KEY_Q, KEY_R, KEY_S, KEY_T, KEY_U, KEY_V, KEY_W, KEY_X, KEY_Y, KEY_Z
@@ -112,6 +113,117 @@ enum Key
 #endif
 
 
+/// @brief A set of keys, one bit per scan code (0..255)
+/// @note Make one with MakeKeySet(), at compile time if the keys are known, e.g.
+/// constexpr KeySet JUMP_KEYS = MakeKeySet({KEY_SPACE, KEY_UP});
+struct KeySet
+{
+    uint32_t bits[8];
+
+    constexpr KeySet() : bits{0, 0, 0, 0, 0, 0, 0, 0} {}
+
+    /// @brief Add a scan code to the set
+    constexpr void add(int code)
+    {
+        if (code >= 0 && code < 256)
+            bits[code / 32] |= 1u << (code % 32);
+    }
+
+    /// @brief Check if a scan code is in the set
+    constexpr bool contains(int code) const
+    {
+        return code >= 0 && code < 256 && ((bits[code / 32] >> (code % 32)) & 1u) != 0;
+    }
+};
+
+/// @brief Add a key to a set, modifiers add both their left and right keys
+constexpr void AddKey(KeySet &set, Key key)
+{
+    switch (key)
+    {
+    case KEY_SHIFT:
+        set.add((int)TK_SHIFT); // some platforms set TK_SHIFT
+        set.add((int)TK_LSHIFT);
+        set.add((int)TK_RSHIFT);
+        break;
+    case KEY_CONTROL:
+        set.add((int)TK_CONTROL);
+        set.add((int)TK_LCONTROL);
+        set.add((int)TK_RCONTROL);
+        break;
+    case KEY_ALT:
+        set.add((int)TK_ALT);
+        set.add((int)TK_LALT);
+        set.add((int)TK_RALT);
+        break;
+    default:
+        set.add((int)key);
+        break;
+    }
+}
+
+/// @brief Make a set of keys, e.g. MakeKeySet({WASD_KEYSET})
+constexpr KeySet MakeKeySet(std::initializer_list<Key> keys)
+{
+    KeySet set;
+    for (Key key : keys)
+    {
+        AddKey(set, key);
+    }
+    return set;
+}
+
+/// @brief Make a set of keys from a list chosen at run time
+KeySet MakeKeySet(const std::vector<Key>& keys);
+
+/// @brief Make a set of every scan code
+constexpr KeySet MakeAllKeySet()
+{
+    KeySet set;
+    for (int i = 0; i < 8; i++)
+    {
+        set.bits[i] = 0xFFFFFFFF;
+    }
+    return set;
+}
+
+constexpr KeySet ALPHABET_KEYS = MakeKeySet({ALPHABET_KEYSET});
+constexpr KeySet WASD_KEYS = MakeKeySet({WASD_KEYSET});
+constexpr KeySet ARROW_KEYS = MakeKeySet({ARROW_KEYSET});
+constexpr KeySet ALL_KEYS = MakeAllKeySet();
+
+/// @brief The keyboard as of one update, and the update before it, see FEHKeyboard::state()
+/// @note It is a plain value, so taking one and asking it questions never allocates memory
+struct KeyboardState
+{
+    KeySet held;     // Keys down as of the last update
+    KeySet previous; // Keys down as of the update before
+
+    /// @brief Check if any key in a set is down
+    bool anyHeld(const KeySet& keys) const;
+    /// @brief Check if every key in a set is down, for modifiers either side counts
+    bool allHeld(const std::initializer_list<Key>& keys) const;
+    /// @brief Check if any key in a set went down in the last update
+    bool anyPressed(const KeySet& keys) const;
+    /// @brief Check if any key in a set came up in the last update
+    bool anyReleased(const KeySet& keys) const;
+
+    /// @brief Check if a key is down
+    bool isHeld(Key key) const { return anyHeld(MakeKeySet({key})); }
+    /// @brief Check if a key went down in the last update
+    bool wasPressed(Key key) const { return anyPressed(MakeKeySet({key})); }
+    /// @brief Check if a key came up in the last update
+    bool wasReleased(Key key) const { return anyReleased(MakeKeySet({key})); }
+};
+
+/// @brief A key press or release, see FEHKeyboard::nextKeyEvent()
+struct KeyEvent
+{
+    Key key;      // Key, or scan code (0..255) for keys not in the Key enum
+    bool pressed; // true for a press, false for a release
+    double time;  // When it happened, in seconds (the same clock as LCD touch events)
+};
+
 class FEHKeyboard
 {
 
@@ -139,6 +251,16 @@ public:
     /// @return Boolean value indicating if any specified keys are pressed
     bool areAnyPressed(const std::vector<Key>& keys = {});
 
+    /// @brief Check if any keys in a set are pressed
+    /// @param keys Set of keys to check, e.g. WASD_KEYS
+    /// @return Boolean value indicating if any keys in the set are pressed
+    bool areAnyPressed(const KeySet& keys);
+
+    /// @brief Take a snapshot of the whole keyboard, as of the last LCD.Update()
+    /// @note Take it once per frame and ask it about as many keys as needed, it allocates no memory
+    /// @return Keys held now and in the update before, for checking what was pressed or released this frame
+    KeyboardState state();
+
     /// @brief Wait for a key to be pressed
     /// @param timeout Time to wait for a key to be pressed, in seconds
     /// @note If timeout is 0, the function will wait indefinitely
@@ -187,6 +309,13 @@ public:
     /// @return Boolean value indicating if no keys were pressed except for the specified keys
     bool waitNoKeysExcept(const std::vector<Key>& keys, double timeout = 0);
 
+    /// @brief Take the oldest key press or release that has not been read yet
+    /// @param event Filled in with the event
+    /// @return true if there was an event
+    /// @note Presses and releases are queued as they happen, so a quick tap between two updates
+    /// is not lost the way it can be with isPressed(). Only the latest TIGR_EVENT_QUEUE are kept.
+    bool nextKeyEvent(KeyEvent *event);
+
     /// @brief Return a list of currently pressed scan codes (0..255)
     std::vector<int> pressedScanCodes();
 
@@ -197,17 +326,7 @@ public:
 
     private:
 
-    /// @brief Makes masks for each key set
-    /// @param keys Keys of interest
-    /// @return vector of 8 uint32_t masks
-    std::vector<uint32_t> makeMasks(const std::vector<Key>& keys = {});
-
     void debugPrint();
-
-    /// @brief Check if any keys are pressed
-    /// @param masks Predefined masks to check
-    /// @return Boolean value indicating if any keys in the mask are pressed
-    bool areAnyPressed(std::vector<uint32_t>& masks);
 };
 
 extern FEHKeyboard Keyboard;
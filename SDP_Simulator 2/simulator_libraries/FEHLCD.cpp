@@ -1,8 +1,23 @@
 #include "FEHLCD.h"
+#include "FEHKeyboard.h"
 #include "FEHSD.h"
 #include "FEHUtility.h"
 #include "FEHRandom.h"
 #include <iostream>
+#include <chrono>
+#include <thread>
+#ifdef TIGR_HEADLESS
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+// Frames the game keeps running after the last script event before the window is closed,
+// so a script without a close line, or a run without a script, still ends
+#define SCRIPT_END_FRAMES 600
+
+static void PlayInputScript(Tigr *bmp, int frame, void *userData);
+#endif
 
 #define WINDOW_WIDTH LCD_WIDTH // TODO: Consider changing the actual window width and height to have a border around the "screen"
 #define WINDOW_HEIGHT LCD_HEIGHT
@@ -126,6 +141,7 @@ FEHLCD::FEHLCD()
     _currentchar = 0;
     _currentY = 0;     // Initialize Y position
     _fontScale = 1.0f; // Initialize font scale to 1.0
+    _nextGlyphSet = 0;
 }
 
 void FEHLCD::SetFontScale(float scale)
@@ -163,7 +179,20 @@ void FEHLCD::_Initialize()
     _forecolor = WHITE;
     _backcolor = BLACK;
 
-    screen = tigrWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Proteus Simulator", TIGR_FIXED & TIGR_RETINA);
+    _window = tigrWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Proteus Simulator", TIGR_FIXED & TIGR_RETINA);
+    screen = _window;
+    _staticLayer = NULL;
+    _staticLayerChanged = false;
+    _dynamicDrawn = false;
+
+#ifdef TIGR_HEADLESS
+    const char *script = getenv("FEH_INPUT_SCRIPT");
+    if (!script || !LoadInputScript(script))
+    {
+        // Nothing to play, but the run still has to end
+        tigrHeadlessScript(_window, PlayInputScript, NULL);
+    }
+#endif
 
     Clear();
 
@@ -193,11 +222,74 @@ bool FEHLCD::Touch(int *x_pos, int *y_pos, bool update_screen)
         Update();
 
     int mouseButton;
-    tigrMouse(screen, x_pos, y_pos, &mouseButton);
+    tigrMouse(_window, x_pos, y_pos, &mouseButton);
 
     return (mouseButton & 0x01) == 1;
 }
 
+bool FEHLCD::WaitForInput(double timeout)
+{
+    if (timeout < 0)
+        return false;
+
+    unsigned long start = TimeNowMSec();
+    unsigned long limit = (unsigned long)(timeout * 1000);
+
+    int startX, startY, startButtons;
+    tigrMouse(_window, &startX, &startY, &startButtons);
+    // Keyboard snapshots are plain values, so the loop below never allocates
+    KeyboardState startKeys, keys;
+    tigrKeyboardState(_window, startKeys.held.bits, startKeys.previous.bits);
+
+    while (true)
+    {
+        Update();
+
+        int x, y, buttons;
+        tigrMouse(_window, &x, &y, &buttons);
+        if (buttons != startButtons || (buttons && (x != startX || y != startY)))
+            return true;
+        tigrKeyboardState(_window, keys.held.bits, keys.previous.bits);
+        if (memcmp(keys.held.bits, startKeys.held.bits, sizeof(keys.held.bits)) != 0)
+            return true;
+
+        unsigned long waited = TimeNowMSec() - start;
+        if (timeout != 0 && waited >= limit)
+            return false;
+
+#ifndef TIGR_HEADLESS
+        // Scripted input arrives by frame, so a headless run does not need to wait for it
+        unsigned long pause = LCD_UPDATE_INTERVAL;
+        if (timeout != 0 && limit - waited < pause)
+            pause = limit - waited;
+        std::this_thread::sleep_for(std::chrono::milliseconds(pause));
+#endif
+    }
+}
+
+bool FEHLCD::NextTouchEvent(TouchEvent *event)
+{
+    TigrEvent next;
+    while (tigrPopMouseEvent(_window, &next))
+    {
+        // The screen only knows the left button
+        if (next.button != 1)
+            continue;
+
+        event->pressed = next.type == TIGR_MOUSE_DOWN;
+        event->x = next.x;
+        event->y = next.y;
+        event->time = next.time;
+        return true;
+    }
+    return false;
+}
+
+double FEHLCD::GetInputLatency()
+{
+    return tigrInputLatency(_window);
+}
+
 void FEHLCD::Clear(unsigned int color)
 {
     SetBackgroundColor(color);
@@ -215,15 +307,172 @@ void FEHLCD::Clear()
 
 void FEHLCD::Update()
 {
-    tigrUpdate(screen);
+    tigrUpdate(_window);
 
-    if (tigrClosed(screen))
+    if (tigrClosed(_window))
     {
+#ifdef TIGR_HEADLESS
+        // Let CI keep the last frame of a scripted run
+        const char *screenshot = getenv("FEH_SCREENSHOT");
+        if (screenshot)
+        {
+            SaveScreenshot(screenshot);
+        }
+#endif
         SD.FCloseAll();
         exit(0);
     }
 }
 
+unsigned int FEHLCD::GetPixel(int x, int y)
+{
+    TPixel pixel = tigrGet(_window, x, y);
+    return ((unsigned int)pixel.r << 16) | ((unsigned int)pixel.g << 8) | (unsigned int)pixel.b;
+}
+
+bool FEHLCD::SaveScreenshot(const char *filename)
+{
+    if (tigrSaveImage(filename, _window) == 0)
+    {
+        std::cout << CONSOLE_ERR("") << CONSOLE_BLUE("(SaveScreenshot)") << " could not write " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#ifdef TIGR_HEADLESS
+
+// One line of an input script
+struct ScriptEvent
+{
+    int frame;
+    std::string type;
+    int a, b;
+};
+
+// LCD is constructed (and loads FEH_INPUT_SCRIPT) before the globals below it in this file,
+// so the event list is created on first use instead
+static std::vector<ScriptEvent> &ScriptEvents()
+{
+    static std::vector<ScriptEvent> events;
+    return events;
+}
+
+static size_t nextScriptEvent = 0;
+
+static bool EarlierFrame(const ScriptEvent &a, const ScriptEvent &b)
+{
+    return a.frame < b.frame;
+}
+
+// Applies every script event up to this frame, called by tigrUpdate
+static void PlayInputScript(Tigr *bmp, int frame, void *userData)
+{
+    (void)userData;
+    std::vector<ScriptEvent> &scriptEvents = ScriptEvents();
+    while (nextScriptEvent < scriptEvents.size() && scriptEvents[nextScriptEvent].frame <= frame)
+    {
+        ScriptEvent &event = scriptEvents[nextScriptEvent];
+        if (event.type == "touch")
+        {
+            tigrHeadlessMouse(bmp, event.a, event.b, 1);
+        }
+        else if (event.type == "release")
+        {
+            int x, y;
+            tigrMouse(bmp, &x, &y, NULL);
+            tigrHeadlessMouse(bmp, x, y, 0);
+        }
+        else if (event.type == "key")
+        {
+            tigrHeadlessKey(bmp, event.a, event.b);
+        }
+        else if (event.type == "char")
+        {
+            tigrHeadlessChar(bmp, event.a);
+        }
+        else if (event.type == "close")
+        {
+            tigrHeadlessClose(bmp);
+        }
+        nextScriptEvent++;
+    }
+
+    int lastFrame = scriptEvents.empty() ? 0 : scriptEvents.back().frame;
+    if (nextScriptEvent == scriptEvents.size() && frame >= lastFrame + SCRIPT_END_FRAMES)
+    {
+        tigrHeadlessClose(bmp);
+    }
+}
+
+bool FEHLCD::LoadInputScript(const char *filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        std::cout << CONSOLE_ERR("") << CONSOLE_BLUE("(LoadInputScript)") << " could not open " << filename << std::endl;
+        return false;
+    }
+
+    std::vector<ScriptEvent> &scriptEvents = ScriptEvents();
+    scriptEvents.clear();
+    nextScriptEvent = 0;
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        std::istringstream words(line);
+        ScriptEvent event;
+        event.a = 0;
+        event.b = 0;
+        if (!(words >> event.frame) || line[0] == '#')
+        {
+            continue;
+        }
+        words >> event.type;
+
+        bool valid = true;
+        if (event.type == "touch")
+        {
+            valid = (bool)(words >> event.a >> event.b);
+        }
+        else if (event.type == "key")
+        {
+            // A single character is that key ('A', '1'), anything longer is a key code
+            std::string key, state;
+            valid = (bool)(words >> key >> state);
+            event.a = key.size() == 1 ? (unsigned char)key[0] : atoi(key.c_str());
+            event.b = state == "down";
+            valid = valid && event.a > 0 && event.a < 256;
+        }
+        else if (event.type == "char")
+        {
+            std::string c;
+            valid = (bool)(words >> c);
+            event.a = c.empty() ? 0 : (unsigned char)c[0];
+        }
+        else if (event.type != "release" && event.type != "close")
+        {
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            std::cout << CONSOLE_WARN("") << CONSOLE_BLUE("(LoadInputScript)") << " ignoring line " << lineNumber << ": " << line << std::endl;
+            continue;
+        }
+        scriptEvents.push_back(event);
+    }
+
+    std::stable_sort(scriptEvents.begin(), scriptEvents.end(), EarlierFrame);
+    tigrHeadlessScript(_window, PlayInputScript, NULL);
+    return true;
+}
+
+#endif // TIGR_HEADLESS
+
 void FEHLCD::SetFontColor(unsigned int color)
 {
     // Currently takes in a 24-bit color as input
@@ -266,6 +515,7 @@ void FEHLCD::DrawPixel(int x, int y)
     y = y % _height;
 
     tigrPlot(screen, x, y, tigr_forecolor());
+    _Damage(x, y, 1, 1);
 }
 
 void FEHLCD::DrawHorizontalLine(int y, int x1, int x2)
@@ -312,6 +562,99 @@ void FEHLCD::DrawLine(int x1, int y1, int x2, int y2)
 void FEHLCD::_DrawLine(int x1, int y1, int x2, int y2)
 {
     tigrLine(screen, x1, y1, x2, y2, tigr_forecolor());
+
+    // The line stays inside the box around its end points
+    int left = x1 < x2 ? x1 : x2;
+    int top = y1 < y2 ? y1 : y2;
+    _Damage(left, top, abs(x2 - x1) + 1, abs(y2 - y1) + 1);
+}
+
+void FEHLCD::_Damage(int x, int y, int width, int height)
+{
+    // Drawing on the static layer does not change the window
+    if (screen != _window)
+    {
+        return;
+    }
+    tigrDamage(_window, x, y, width, height);
+
+    // Remember the area so DrawStaticLayer() can put the static layer back there
+    int left = x < 0 ? 0 : x;
+    int top = y < 0 ? 0 : y;
+    int right = x + width > _window->w ? _window->w : x + width;
+    int bottom = y + height > _window->h ? _window->h : y + height;
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+
+    if (!_dynamicDrawn)
+    {
+        _dynamicDrawn = true;
+        _dynamic[0] = left;
+        _dynamic[1] = top;
+        _dynamic[2] = right;
+        _dynamic[3] = bottom;
+        return;
+    }
+    _dynamic[0] = left < _dynamic[0] ? left : _dynamic[0];
+    _dynamic[1] = top < _dynamic[1] ? top : _dynamic[1];
+    _dynamic[2] = right > _dynamic[2] ? right : _dynamic[2];
+    _dynamic[3] = bottom > _dynamic[3] ? bottom : _dynamic[3];
+}
+
+void FEHLCD::BeginStaticLayer()
+{
+    if (_staticLayer == NULL)
+    {
+        _staticLayer = tigrBitmap(_window->w, _window->h);
+    }
+    screen = _staticLayer;
+}
+
+void FEHLCD::EndStaticLayer()
+{
+    if (screen == _staticLayer)
+    {
+        screen = _window;
+        _staticLayerChanged = true;
+    }
+}
+
+void FEHLCD::DrawStaticLayer()
+{
+    _currentline = 0;
+    _currentY = 0; // Reset Y position, the same as Clear()
+
+    if (_staticLayer == NULL)
+    {
+        _Clear();
+        return;
+    }
+    EndStaticLayer();
+
+    // Copy the whole layer after it was redrawn, otherwise only what was drawn over it
+    int left = 0, top = 0, right = _window->w, bottom = _window->h;
+    if (!_staticLayerChanged)
+    {
+        if (!_dynamicDrawn)
+        {
+            return;
+        }
+        left = _dynamic[0];
+        top = _dynamic[1];
+        right = _dynamic[2];
+        bottom = _dynamic[3];
+    }
+
+    for (int y = top; y < bottom; y++)
+    {
+        memcpy(&_window->pix[y * _window->w + left], &_staticLayer->pix[y * _window->w + left], (right - left) * sizeof(TPixel));
+    }
+    tigrDamage(_window, left, top, right - left, bottom - top);
+
+    _staticLayerChanged = false;
+    _dynamicDrawn = false;
 }
 
 void FEHLCD::DrawRectangle(int x, int y, int width, int height)
@@ -327,6 +670,7 @@ void FEHLCD::DrawRectangle(int x, int y, int width, int height)
         std::cout << CONSOLE_WARN("") << CONSOLE_BLUE("(DrawRectangle)") << " y + height is out of bounds: " << y + height << std::endl;
 
     tigrRect(screen, x, y, width, height, tigr_forecolor());
+    _Damage(x, y, width, height);
 }
 
 void FEHLCD::FillRectangle(int x, int y, int width, int height)
@@ -342,6 +686,7 @@ void FEHLCD::FillRectangle(int x, int y, int width, int height)
         std::cout << CONSOLE_WARN("") << CONSOLE_BLUE("(FillRectangle)") << " y + height is out of bounds: " << y + height << std::endl;
 
     tigrFill(screen, x, y, width, height, tigr_forecolor());
+    _Damage(x, y, width, height);
 }
 
 void FEHLCD::DrawCircle(int x0, int y0, int r)
@@ -655,6 +1000,7 @@ void FEHLCD::_Clear()
     // Currently takes in a 24-bit color as input
     TPixel rgbValues = tigrRGB((char)(_backcolor >> 16), (char)(_backcolor >> 8), (char)_backcolor);
     tigrClear(screen, rgbValues);
+    _Damage(0, 0, _width, _height);
 }
 
 void FEHLCD::WriteChar(int row, int col, char c)
@@ -705,40 +1051,162 @@ void FEHLCD::WriteCharAt(int x, int y, char c)
     // Shift all of the input character values down by 32 so that they can be used as indexes of the fontData array
     c -= 32;
 
-    // Look up the bitmap data out of the fontData table
-    // Each entry in the fontData table corresponds
-    // to a column of pixels in the 5x7 bitmapped character
-    unsigned char charData[5];
-    charData[0] = fontData[5 * c];
-    charData[1] = fontData[5 * c + 1];
-    charData[2] = fontData[5 * c + 2];
-    charData[3] = fontData[5 * c + 3];
-    charData[4] = fontData[5 * c + 4];
-
-    // Plot the character data pixel-by-pixel. Each character will be scaled based on _fontScale
-    // Base size is 10x14 (doubled from 5x7), plus spacing makes it 12x17
-
     // 2 blank columns, scaled
     x += (int)(2 * _fontScale);
 
+    const Glyph *glyph = GetGlyph(c);
+    if (glyph->width <= 0)
+    {
+        return;
+    }
+
+    // The glyph's font pixels start 3 rows down
+    y += 3;
+
+    // Clip the glyph to the screen, text running off the right or bottom edge is cut off
+    int right = glyph->width;
+    int rows = glyph->height;
+    if (x + right > screen->w)
+    {
+        right = screen->w - x;
+    }
+    if (y + rows > screen->h)
+    {
+        rows = screen->h - y;
+    }
+    if (right <= 0 || rows <= 0)
+    {
+        return;
+    }
+
+    // Fill each run of font pixels with the font color, so the cost is the lit area only
+    TPixel color = tigr_forecolor();
+    TPixel *origin = &screen->pix[y * screen->w + x];
+    for (size_t i = 0; i < glyph->spans.size(); i++)
+    {
+        const GlyphSpan &span = glyph->spans[i];
+        if (span.row >= rows)
+        {
+            break;
+        }
+        int end = span.start + span.length;
+        if (end > right)
+        {
+            end = right;
+        }
+        TPixel *pixel = origin + span.row * screen->w;
+        for (int j = span.start; j < end; j++)
+        {
+            pixel[j] = color;
+        }
+    }
+
+    _Damage(x, y, right, rows);
+}
+
+/*
+ Returns the font pixels of character c (already shifted down by 32) at the current
+ font scale. Each character is rasterized the first time it is written at a scale,
+ with the same 2x2 (scaled) blocks WriteCharAt used to fill one by one, and kept
+ until the program ends. A few scales are kept at once, so text that switches
+ between scales every frame does not rebuild its glyphs.
+ */
+const FEHLCD::Glyph *FEHLCD::GetGlyph(int c)
+{
+    GlyphSet *set = NULL;
+    for (int i = 0; i < (int)_glyphSets.size(); i++)
+    {
+        if (_glyphSets[i].scale == _fontScale)
+        {
+            set = &_glyphSets[i];
+            break;
+        }
+    }
+
+    if (set == NULL)
+    {
+        // Reuse the oldest set once the limit is reached
+        if ((int)_glyphSets.size() < GLYPH_SET_LIMIT)
+        {
+            _glyphSets.push_back(GlyphSet());
+            set = &_glyphSets.back();
+        }
+        else
+        {
+            set = &_glyphSets[_nextGlyphSet];
+            _nextGlyphSet = (_nextGlyphSet + 1) % GLYPH_SET_LIMIT;
+        }
+        set->scale = _fontScale;
+        for (int i = 0; i < GLYPH_COUNT; i++)
+        {
+            set->glyphs[i].built = false;
+        }
+    }
+
+    Glyph *glyph = &set->glyphs[c];
+    if (glyph->built)
+    {
+        return glyph;
+    }
+
+    // Base size is 10x14 (doubled from 5x7), the last block starts at column 4 / row 6
     int pixelSize = (int)(2 * _fontScale); // Scale the 2x2 pixel size
+    glyph->built = true;
+    glyph->width = 0;
+    glyph->height = 0;
+    glyph->spans.clear();
+    if (pixelSize <= 0)
+    {
+        return glyph;
+    }
+    glyph->width = (int)(4 * 2 * _fontScale) + pixelSize;
+    glyph->height = (int)(6 * 2 * _fontScale) + pixelSize;
+    std::vector<unsigned char> mask(glyph->width * glyph->height, 0);
 
+    // Each entry in the fontData table corresponds
+    // to a column of pixels in the 5x7 bitmapped character
     for (int col = 0; col < 5; col++)
     {
+        unsigned char charData = fontData[5 * c + col];
         for (int row = 0; row < 7; row++)
         {
             // If the current pixel is a 1 in the fontData bitmap
-            if (((charData[col] >> row) & 0x01) == 1)
+            if (((charData >> row) & 0x01) == 1)
             {
-                // Draw a scaled rectangle to represent each pixel
-                FillRectangle(
-                    x + (int)(col * 2 * _fontScale),
-                    y + 3 + (int)(row * 2 * _fontScale),
-                    pixelSize,
-                    pixelSize);
+                int x0 = (int)(col * 2 * _fontScale);
+                int y0 = (int)(row * 2 * _fontScale);
+                for (int y = y0; y < y0 + pixelSize; y++)
+                {
+                    memset(&mask[y * glyph->width + x0], 1, pixelSize);
+                }
+            }
+        }
+    }
+
+    // Keep the runs of set pixels, top row first
+    for (int row = 0; row < glyph->height; row++)
+    {
+        int col = 0;
+        while (col < glyph->width)
+        {
+            if (mask[row * glyph->width + col] == 0)
+            {
+                col++;
+                continue;
             }
+            GlyphSpan span;
+            span.row = row;
+            span.start = col;
+            while (col < glyph->width && mask[row * glyph->width + col] != 0)
+            {
+                col++;
+            }
+            span.length = col - span.start;
+            glyph->spans.push_back(span);
         }
     }
+
+    return glyph;
 }
 
 unsigned int FEHLCD::Convert24BitColorTo16Bit(unsigned int color)
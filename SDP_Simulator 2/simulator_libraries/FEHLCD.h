@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <cstring>
 #include <string>
+#include <vector>
 #include "tigr.h"
 #include "LCDColors.h"
 
@@ -13,6 +14,18 @@
 #define LCD_WIDTH 320
 #define LCD_HEIGHT 240
 
+// Milliseconds between window updates while waiting in WaitForInput() or Sleep()
+#define LCD_UPDATE_INTERVAL 16
+
+/// @brief A touch or release of the screen, see FEHLCD::NextTouchEvent()
+struct TouchEvent
+{
+    bool pressed; // true for a touch, false for a release
+    int x;        // Where it happened
+    int y;
+    double time;  // When it happened, in seconds (the same clock as keyboard events)
+};
+
 
 class FEHLCD
 {
@@ -22,6 +35,7 @@ class FEHLCD
     friend class FEHImage;
     // friend class FEHKeyboard;
 protected:
+    // Where drawing goes: the window, or the static layer between BeginStaticLayer() and EndStaticLayer()
     Tigr *screen;
 
 public:
@@ -46,12 +60,31 @@ public:
     bool Touch(float *x_pos, float *y_pos, bool update_screen = true);
     ///@}
 
+    /// @brief Take the oldest touch or release of the screen that has not been read yet
+    /// @param event Filled in with the event
+    /// @return true if there was an event
+    /// @note Touches and releases are queued as they happen, so a quick tap between two Update() calls
+    /// is not lost the way it can be with Touch(). Only the latest TIGR_EVENT_QUEUE are kept.
+    bool NextTouchEvent(TouchEvent *event);
+
+    /// @brief Get the time from the first input after a frame was shown to the next frame shown
+    /// @return Latest input-to-present latency in seconds, or 0 if there was no input yet
+    double GetInputLatency();
+
+    /// @brief Wait until the screen is touched, released or dragged, or a key is pressed or released
+    /// @param timeout Longest time to wait, in seconds
+    /// @return true if input arrived, false if the timeout ran out
+    /// @note If timeout is 0, the function will wait indefinitely. Unlike a loop calling Update(),
+    /// the window is updated LCD_UPDATE_INTERVAL milliseconds apart and the CPU is idle in between.
+    bool WaitForInput(double timeout = 0);
+
     /// @private
     /// @brief One-time setup for LCD object
     void Initialize();
 
-    // Provide safe access to the underlying Tigr* for helpers
-    Tigr* getScreen() { return screen; }
+    // Provide safe access to the underlying Tigr* window for helpers
+    // Helpers that draw on it directly must report what they drew with tigrDamage()
+    Tigr* getScreen() { return _window; }
 
     /// @brief Clear the screen to a specific color
     /// @param color Color to clear the screen to
@@ -64,6 +97,45 @@ public:
     /// @note This function must be called for the user to see any changes made to the screen
     void Update();
 
+    /// @name Static Layer
+    ///@{
+    /// @brief Start drawing the static layer, the part of a screen that looks the same every frame
+    /// @note Until EndStaticLayer() is called, every drawing function draws to an off-screen layer instead of the screen
+    void BeginStaticLayer();
+
+    /// @brief Stop drawing the static layer and go back to drawing on the screen
+    void EndStaticLayer();
+
+    /// @brief Start a frame by putting the static layer back on the screen, use it in place of Clear()
+    /// @note Only the area drawn on since the last DrawStaticLayer() is copied, so the static
+    /// content is drawn once and each frame only redraws the sprites and text that change.
+    /// Clears the screen if there is no static layer.
+    void DrawStaticLayer();
+    ///@}
+
+    /// @brief Get the color of a pixel currently on the screen
+    /// @param x X coordinate of the pixel
+    /// @param y Y coordinate of the pixel
+    /// @return 24-bit color of the pixel, or 0 if it is off the screen
+    unsigned int GetPixel(int x, int y);
+
+    /// @brief Save the screen to a PNG file
+    /// @param filename Name of the file to write
+    /// @return true if the file was written
+    bool SaveScreenshot(const char *filename);
+
+#ifdef TIGR_HEADLESS
+    /// @brief (Headless builds only) Read touch and key input for the coming frames from a script file
+    /// @param filename Name of the script file
+    /// @return true if the script was read
+    /// @note The script named by the FEH_INPUT_SCRIPT environment variable is loaded automatically.
+    /// Each line is a frame number (Update() calls so far) and an event:
+    /// "touch x y", "release", "key K down", "key K up", "char c" or "close".
+    /// Lines starting with # are ignored. The window is closed 600 frames after the last event
+    /// (or after frame 600 without a script), so the run always ends.
+    bool LoadInputScript(const char *filename);
+#endif
+
     /// @brief Set the font color, which is the color used for writing text AND drawing shapes
     /// @param color Color to set
     void SetFontColor(unsigned int color);
@@ -162,6 +234,16 @@ private:
     /// @note Does not check for bounds, not intended for public use
     void _DrawLine(int x1, int y1, int x2, int y2);
 
+    /// @brief Internal function to mark an area of the screen as changed
+    /// @note Update() only sends the changed area to the window, and DrawStaticLayer() only restores the changed area
+    void _Damage(int x, int y, int width, int height);
+
+    Tigr *_window;
+    Tigr *_staticLayer;
+    bool _staticLayerChanged; // The whole layer has to be copied by the next DrawStaticLayer()
+    bool _dynamicDrawn;       // Something was drawn on the window since the last DrawStaticLayer()
+    int _dynamic[4];          // Box around it: left, top, right, bottom (exclusive)
+
 
     int abs(int n) { return n > 0 ? n : -n; }
 
@@ -171,6 +253,34 @@ private:
     void WriteChar(int row, int col, char c);
     void WriteCharAt(int x, int y, char c);
 
+    // One run of font pixels in a row of a glyph
+    struct GlyphSpan
+    {
+        short row;
+        short start;
+        short length;
+    };
+
+    // Font pixels of one character at one font scale, as runs of pixels in the font color
+    struct Glyph
+    {
+        bool built;
+        int width;
+        int height;
+        std::vector<GlyphSpan> spans;
+    };
+
+    // Every character at one font scale
+    static const int GLYPH_COUNT = 94;
+    static const int GLYPH_SET_LIMIT = 4;
+    struct GlyphSet
+    {
+        float scale;
+        Glyph glyphs[GLYPH_COUNT];
+    };
+
+    const Glyph *GetGlyph(int c);
+
     unsigned int Convert24BitColorTo16Bit(unsigned int color);
     unsigned int ConvertRGBColorTo16Bit(unsigned char r, unsigned char g, unsigned char b);
 
@@ -188,6 +298,8 @@ private:
     unsigned int _forecolor;
     unsigned int _backcolor;
     float _fontScale; // Font scale factor
+    std::vector<GlyphSet> _glyphSets;
+    int _nextGlyphSet;
 
     TPixel tigr_forecolor() { return FEH2Tigr(_forecolor); }
     TPixel tigr_backcolor() { return FEH2Tigr(_backcolor); }
@@ -1,12 +1,168 @@
 #include "FEHRandom.h"
 
 #include <time.h>
+#include <atomic>
 
 FEHRandom Random;
 
+// Philox4x32-10 constants, from Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3" (SC11)
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+// Seed used by threads that never call Seed() themselves
+static std::atomic<uint64_t> default_seed(0x853C49E6748FEA9BULL);
+
+// Every thread that never calls Seed() gets the next free stream number, so unseeded threads still differ
+static std::atomic<uint64_t> next_default_stream(1ULL << 63);
+
+RandomStream::RandomStream()
+{
+	Seed(0, 0);
+}
+
+RandomStream::RandomStream(uint64_t seed, uint64_t stream)
+{
+	Seed(seed, stream);
+}
+
+void RandomStream::Seed(uint64_t seed, uint64_t stream)
+{
+	key[0] = (uint32_t)seed;
+	key[1] = (uint32_t)(seed >> 32);
+
+	// Low 64 bits of the counter are the block number, high 64 bits are the stream number
+	counter[0] = 0;
+	counter[1] = 0;
+	counter[2] = (uint32_t)stream;
+	counter[3] = (uint32_t)(stream >> 32);
+
+	// Buffer starts empty
+	index = 4;
+}
+
+void RandomStream::Refill()
+{
+	uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+	uint32_t k0 = key[0], k1 = key[1];
+
+	for (int round = 0; round < 10; round++)
+	{
+		uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+		uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+
+		c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+		c1 = (uint32_t)p1;
+		c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		c3 = (uint32_t)p0;
+
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+
+	buffer[0] = c0;
+	buffer[1] = c1;
+	buffer[2] = c2;
+	buffer[3] = c3;
+	index = 0;
+
+	// Advance the 64-bit block number
+	if (++counter[0] == 0)
+	{
+		counter[1]++;
+	}
+}
+
+uint64_t RandomStream::Next64()
+{
+	uint64_t lo = Next32();
+	uint64_t hi = Next32();
+	return (hi << 32) | lo;
+}
+
+int RandomStream::Range(int low, int high)
+{
+	// Lemire's multiply-and-reject method: no modulo bias and, almost always, no division
+	uint32_t range = (uint32_t)(high - low) + 1;
+	uint64_t m = (uint64_t)Next32() * range;
+	uint32_t l = (uint32_t)m;
+
+	if (l < range)
+	{
+		uint32_t threshold = (0u - range) % range;
+		while (l < threshold)
+		{
+			m = (uint64_t)Next32() * range;
+			l = (uint32_t)m;
+		}
+	}
+
+	return low + (int)(m >> 32);
+}
+
+void RandomStream::Jump(uint64_t count)
+{
+	// Position in 32-bit values of the next value to be returned
+	uint64_t block = ((uint64_t)counter[1] << 32) | counter[0];
+	uint64_t position = block * 4 + index - 4 + count;
+
+	block = position / 4;
+	counter[0] = (uint32_t)block;
+	counter[1] = (uint32_t)(block >> 32);
+	index = 4;
+
+	if (position % 4 != 0)
+	{
+		Refill();
+		index = (int)(position % 4);
+	}
+}
+
+void RandomStream::Fill(int *out, int count, int low, int high)
+{
+	// Same method as Range(), with the rejection threshold worked out once for the whole array
+	uint32_t range = (uint32_t)(high - low) + 1;
+	uint32_t threshold = (0u - range) % range;
+
+	for (int i = 0; i < count; i++)
+	{
+		uint64_t m = (uint64_t)Next32() * range;
+		while ((uint32_t)m < threshold)
+		{
+			m = (uint64_t)Next32() * range;
+		}
+		out[i] = low + (int)(m >> 32);
+	}
+}
+
+void RandomStream::Fill(unsigned char *out, int count, int low, int high)
+{
+	uint32_t range = (uint32_t)(high - low) + 1;
+	uint32_t threshold = (0u - range) % range;
+
+	for (int i = 0; i < count; i++)
+	{
+		uint64_t m = (uint64_t)Next32() * range;
+		while ((uint32_t)m < threshold)
+		{
+			m = (uint64_t)Next32() * range;
+		}
+		out[i] = (unsigned char)(low + (int)(m >> 32));
+	}
+}
+
+RandomStream &FEHRandom::Stream()
+{
+	thread_local RandomStream stream(default_seed.load(), next_default_stream.fetch_add(1));
+	return stream;
+}
+
 void FEHRandom::Seed()
 {
-	srand(time(NULL));
+	uint64_t seed = (uint64_t)time(NULL) ^ ((uint64_t)clock() << 32);
+	default_seed.store(seed);
+	Seed(seed, 0);
 
 	// For some reason, it was observed that the first random number didn't seem to be that random :(
 	// So, we fetch a few random numbers for funsies
@@ -16,10 +172,24 @@ void FEHRandom::Seed()
 	RandInt();
 }
 
+void FEHRandom::Seed(uint64_t seed, uint64_t stream)
+{
+	Stream().Seed(seed, stream);
+}
+
 int FEHRandom::RandInt()
 {
 	// We specify in documentation rand will be between 0 and 32767
-	// rand() returns between 0 and RAND_INT, which will be atleast 32767
-	// Thus, modulo by 32767 to ensure it will never be above 32767
-	return rand() % 32767; // steal rand from stdlib.h
-}
\ No newline at end of file
+	// The old rand() % 32767 version never returned 32767, so keep the same range here
+	return Stream().Range(0, 32766);
+}
+
+int FEHRandom::RandRange(int low, int high)
+{
+	return Stream().Range(low, high);
+}
+
+void FEHRandom::Fill(int *out, int count, int low, int high)
+{
+	Stream().Fill(out, count, low, high);
+}
@@ -2,15 +2,86 @@
 #define FEHRANDOM_H
 
 #include <stdlib.h>
+#include <stdint.h>
+
+/// @brief Counter-based random stream (Philox4x32-10)
+/// @note Output block n of a stream is a pure function of (seed, stream, n), so streams never overlap,
+/// jumping ahead is O(1), and a run can be reproduced exactly from its seed and stream number
+class RandomStream
+{
+public:
+	/// @brief Create stream 0 of seed 0
+	RandomStream();
+
+	/// @brief Create a stream
+	/// @param seed Seed shared by every stream of a run
+	/// @param stream Stream number, e.g. the worker thread index
+	RandomStream(uint64_t seed, uint64_t stream);
+
+	/// @brief Restart the stream at its first value
+	/// @param seed Seed shared by every stream of a run
+	/// @param stream Stream number, e.g. the worker thread index
+	void Seed(uint64_t seed, uint64_t stream);
+
+	/// @brief Get the next 32 random bits
+	uint32_t Next32()
+	{
+		if (index == 4)
+		{
+			Refill();
+		}
+		return buffer[index++];
+	}
+
+	/// @brief Get the next 64 random bits
+	uint64_t Next64();
+
+	/// @brief Get an unbiased random integer between low and high (inclusive)
+	int Range(int low, int high);
+
+	/// @brief Skip ahead without generating the skipped values
+	/// @param count Number of 32-bit values to skip
+	void Jump(uint64_t count);
+
+	/// @brief Fill an array with unbiased random integers between low and high (inclusive)
+	/// @param out Array to fill
+	/// @param count Number of values to write
+	void Fill(int *out, int count, int low, int high);
+	void Fill(unsigned char *out, int count, int low, int high);
+
+private:
+	void Refill();
+
+	uint32_t key[2];
+	uint32_t counter[4];
+	uint32_t buffer[4];
+	int index;
+};
 
 class FEHRandom
 {
 public:
 	/// @brief Seed the random number generator
+	/// @note Seeds the calling thread's stream from the clock
 	void Seed();
 
+	/// @brief Seed the random number generator with a fixed value
+	/// @param seed Seed shared by every thread of a run
+	/// @param stream Stream number for the calling thread, use a different one per thread
+	/// @note Each thread has its own stream, so threads never share or lock generator state
+	void Seed(uint64_t seed, uint64_t stream = 0);
+
 	/// @brief Get a random integer between 0 and 32767
 	int RandInt();
+
+	/// @brief Get an unbiased random integer between low and high (inclusive)
+	int RandRange(int low, int high);
+
+	/// @brief Fill an array with unbiased random integers between low and high (inclusive)
+	void Fill(int *out, int count, int low, int high);
+
+	/// @brief Get the calling thread's stream
+	RandomStream &Stream();
 };
 
 extern FEHRandom Random;
@@ -1,5 +1,7 @@
 #include "FEHUtility.h"
 #include <sys/time.h>
+#include <chrono>
+#include <thread>
 #include "FEHLCD.h"
 
 long time_at_last_reset_msec = 0;
@@ -7,9 +9,16 @@ struct timeval current_time;
 
 void Sleep(int msec)
 {
+    // Keep the window responsive, but give the CPU back between updates
     unsigned long t = TimeNowMSec(); 
-    while (TimeNowMSec() - t < (unsigned long) msec) {
+    unsigned long waited;
+    while ((waited = TimeNowMSec() - t) < (unsigned long) msec) {
         LCD.Update();
+        unsigned long pause = msec - waited;
+        if (pause > LCD_UPDATE_INTERVAL) {
+            pause = LCD_UPDATE_INTERVAL;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(pause));
     }
 }
 
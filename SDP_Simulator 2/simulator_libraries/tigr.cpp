@@ -94,7 +94,10 @@ const int tigr_default_fx_gl_fs_size = (int)sizeof(tigr_default_fx_gl_fs) - 1;
 #define _CRT_SECURE_NO_WARNINGS NOPE
 
 // Graphics configuration.
+// TIGR_HEADLESS builds windows as plain in-memory bitmaps, with no display or OpenGL.
+#ifndef TIGR_HEADLESS
 #define TIGR_GAPI_GL
+#endif
 
 // Creates a new bitmap, with extra payload bytes.
 Tigr *tigrBitmap2(int w, int h, int extra);
@@ -118,7 +121,7 @@ void tigrPosition(Tigr *bmp, int scale, int windowW, int windowH, int out[4]);
 #include <stddef.h>
 #endif
 
-#if __linux__ && !__ANDROID__
+#if __linux__ && !__ANDROID__ && !defined(TIGR_HEADLESS)
 #include <X11/X.h>
 #include <X11/Xlib.h>
 #endif
@@ -150,6 +153,8 @@ typedef struct
 	void *glContext;
 #endif
 	GLuint tex[2];
+	int texW[2], texH[2];
+	int presentW, presentH, idleUpdates;
 	GLuint vao;
 	GLuint program;
 	GLuint uniform_projection;
@@ -162,6 +167,14 @@ typedef struct
 
 #define MAX_TOUCH_POINTS 10
 
+// A ring of input events. It is written and read on the thread that calls
+// tigrUpdate, so it needs no lock; head and tail only count up.
+typedef struct
+{
+	TigrEvent events[TIGR_EVENT_QUEUE];
+	unsigned head, tail;
+} TigrEventQueue;
+
 typedef struct
 {
 	int shown, closed;
@@ -174,7 +187,7 @@ typedef struct
 	DWORD dwStyle;
 	RECT oldPos;
 #endif
-#ifdef __linux__
+#if defined(__linux__) && !defined(TIGR_HEADLESS)
 #if __ANDROID__
 	EGLContext context;
 #else
@@ -192,20 +205,46 @@ typedef struct
 
 	float p1, p2, p3, p4;
 
+	// Region changed since the last present, x0 y0 x1 y1 (exclusive).
+	// Only used once tigrDamage has been called, until then every present uploads everything.
+	int damageTracked;
+	int damage[4];
+
+	// Input events not read yet, and the state the queues last reported for
+	// backends that queue changes instead of events.
+	TigrEventQueue mouseEvents, keyEvents;
+	int queuedButtons;
+	char queuedKeys[256];
+	// Time of the first event since the last present (0 for none), and the latest latency.
+	double inputPending, inputLatency;
+
 	int flags;
 	int scale;
 	int pos[4];
 	int lastChar;
 	char keys[256], prev[256];
-#if defined(__APPLE__)
+#if defined(__APPLE__) && !defined(TIGR_HEADLESS)
 	int mouseInView;
 	int mouseButtons;
 #endif
-#ifdef __linux__
+#if defined(__linux__) && !defined(TIGR_HEADLESS)
 	int mouseButtons;
 	int mouseX;
 	int mouseY;
+#if !__ANDROID__
+	int winWidth, winHeight; // Window size, kept up to date by ConfigureNotify
+	int timeOffsetSet;
+	double timeOffset;		 // tigrEventTime() minus X server time, in seconds
+#endif
 #endif // __linux__
+#ifdef TIGR_HEADLESS
+	int mouseButtons;
+	int mouseX;
+	int mouseY;
+	int frame;
+	TigrInputScript script;
+	void *scriptData;
+#endif // TIGR_HEADLESS
 #ifdef __ANDROID__
 	int numTouchPoints;
 	TigrTouchPoint touchPoints[MAX_TOUCH_POINTS];
@@ -220,6 +259,17 @@ void tigrGAPIDestroy(Tigr *bmp);
 int tigrGAPIBegin(Tigr *bmp);
 int tigrGAPIEnd(Tigr *bmp);
 void tigrGAPIPresent(Tigr *bmp, int w, int h);
+int tigrGAPINeedsPresent(Tigr *bmp, int w, int h);
+
+// Adds an event to a queue, dropping the oldest one when it is full.
+void tigrQueueEvent(TigrInternal *win, TigrEventQueue *queue, TigrEventType type, int x, int y, int button, double time);
+
+// Queues the mouse buttons and keys that changed since the last call, for
+// backends that only know the current state.
+void tigrQueueChanges(Tigr *bmp);
+
+// Records the input latency when a frame is presented.
+void tigrPresented(TigrInternal *win);
 
 #endif
 
@@ -253,6 +303,239 @@ void tigrGAPIPresent(Tigr *bmp, int w, int h);
 	if (w <= 0 || h <= 0) \
 	return
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TIGR_SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Row kernels for fills and blits. Each has a scalar version and SSE2/AVX2
+// versions, and tigrKernelInit picks the widest one the CPU supports.
+
+// Fill kernels for tigrClear and tigrFill, they write w copies of color.
+typedef void (*TigrFillRow)(TPixel *td, int w, TPixel color);
+
+static void tigrFillScalar(TPixel *td, int w, TPixel color)
+{
+	int x;
+	for (x = 0; x < w; x++)
+		td[x] = color;
+}
+
+#ifdef TIGR_SIMD_X86
+__attribute__((target("sse2"))) static void tigrFillSSE2(TPixel *td, int w, TPixel color)
+{
+	int bits, x = 0;
+	__m128i v;
+	memcpy(&bits, &color, sizeof(bits));
+	v = _mm_set1_epi32(bits);
+	for (; x + 4 <= w; x += 4)
+		_mm_storeu_si128((__m128i *)(td + x), v);
+	tigrFillScalar(td + x, w - x, color);
+}
+
+__attribute__((target("avx2"))) static void tigrFillAVX2(TPixel *td, int w, TPixel color)
+{
+	int bits, x = 0;
+	__m256i v;
+	memcpy(&bits, &color, sizeof(bits));
+	v = _mm256_set1_epi32(bits);
+	for (; x + 8 <= w; x += 8)
+		_mm256_storeu_si256((__m256i *)(td + x), v);
+	tigrFillScalar(td + x, w - x, color);
+}
+#endif // TIGR_SIMD_X86
+
+// Blend kernels for tigrBlitTint. Every kernel gives exactly the same result as the
+// scalar one, which is the original tigr blend:
+//   d += (s * tint - d) * (tint.a * s.a) >> 16   (s.a and tint are EXPANDed to 0-256)
+// The SIMD kernels use the equivalent form (s * tint * a + d * (65536 - a)) >> 16,
+// which only needs unsigned 16 bit multiplies.
+typedef void (*TigrBlendRow)(TPixel *td, const TPixel *ts, int w, int xr, int xg, int xb, int xa);
+
+static void tigrBlendScalar(TPixel *td, const TPixel *ts, int w, int xr, int xg, int xb, int xa)
+{
+	int x;
+	for (x = 0; x < w; x++)
+	{
+		unsigned r = (xr * ts[x].r) >> 8;
+		unsigned g = (xg * ts[x].g) >> 8;
+		unsigned b = (xb * ts[x].b) >> 8;
+		unsigned a = xa * EXPAND(ts[x].a);
+		td[x].r += (unsigned char)((r - td[x].r) * a >> 16);
+		td[x].g += (unsigned char)((g - td[x].g) * a >> 16);
+		td[x].b += (unsigned char)((b - td[x].b) * a >> 16);
+		td[x].a += (unsigned char)((ts[x].a - td[x].a) * a >> 16);
+	}
+}
+
+// Opacity of a block of up to TIGR_RUN_BLOCK source pixels, for splitting rows into runs.
+#define TIGR_RUN_TRANSPARENT 0
+#define TIGR_RUN_OPAQUE 1
+#define TIGR_RUN_MIXED 2
+#define TIGR_RUN_BLOCK 16
+
+typedef int (*TigrAlphaRun)(const TPixel *p, int n);
+
+static int tigrAlphaRunScalar(const TPixel *p, int n)
+{
+	unsigned char all = 255, any = 0;
+	int i;
+	for (i = 0; i < n; i++)
+	{
+		all &= p[i].a;
+		any |= p[i].a;
+	}
+	return any == 0 ? TIGR_RUN_TRANSPARENT : (all == 255 ? TIGR_RUN_OPAQUE : TIGR_RUN_MIXED);
+}
+
+#ifdef TIGR_SIMD_X86
+
+// Checks the alpha bytes of a whole block at once.
+__attribute__((target("sse2"))) static int tigrAlphaRunSSE2(const TPixel *p, int n)
+{
+	__m128i all, any, zero;
+	int i, opaque, transparent;
+	if (n != TIGR_RUN_BLOCK)
+		return tigrAlphaRunScalar(p, n);
+
+	all = _mm_set1_epi8((char)0xff);
+	any = _mm_setzero_si128();
+	for (i = 0; i < TIGR_RUN_BLOCK; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+		all = _mm_and_si128(all, v);
+		any = _mm_or_si128(any, v);
+	}
+
+	// Only bytes 3, 7, 11 and 15 are alpha.
+	zero = _mm_setzero_si128();
+	transparent = (_mm_movemask_epi8(_mm_cmpeq_epi8(any, zero)) & 0x8888) == 0x8888;
+	opaque = (_mm_movemask_epi8(_mm_cmpeq_epi8(all, _mm_set1_epi8((char)0xff))) & 0x8888) == 0x8888;
+	return transparent ? TIGR_RUN_TRANSPARENT : (opaque ? TIGR_RUN_OPAQUE : TIGR_RUN_MIXED);
+}
+
+// Blends two pixels held as eight 16 bit channels.
+// a = tint.a * EXPAND(s.a) wraps to 0 at 65536, so the a == 0 (keep d) and
+// a == 65536 (take s * tint) lanes are picked out separately.
+__attribute__((target("sse2"))) static inline __m128i tigrBlend2SSE2(__m128i s, __m128i d, __m128i tint, __m128i xa, __m128i fullTint)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i r = _mm_srli_epi16(_mm_mullo_epi16(s, tint), 8);
+	__m128i sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+	__m128i e = _mm_add_epi16(sa, _mm_min_epi16(sa, _mm_set1_epi16(1)));
+	__m128i a = _mm_mullo_epi16(e, xa);
+	__m128i b = _mm_sub_epi16(zero, a);
+
+	__m128i rl = _mm_mullo_epi16(r, a), rh = _mm_mulhi_epu16(r, a);
+	__m128i dl = _mm_mullo_epi16(d, b), dh = _mm_mulhi_epu16(d, b);
+	__m128i lo = _mm_add_epi32(_mm_unpacklo_epi16(rl, rh), _mm_unpacklo_epi16(dl, dh));
+	__m128i hi = _mm_add_epi32(_mm_unpackhi_epi16(rl, rh), _mm_unpackhi_epi16(dl, dh));
+	__m128i out = _mm_packs_epi32(_mm_srli_epi32(lo, 16), _mm_srli_epi32(hi, 16));
+
+	__m128i keep = _mm_cmpeq_epi16(a, zero);
+	__m128i take = _mm_and_si128(_mm_cmpeq_epi16(e, _mm_set1_epi16(256)), fullTint);
+	out = _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, out));
+	out = _mm_or_si128(_mm_and_si128(take, r), _mm_andnot_si128(take, out));
+	return out;
+}
+
+__attribute__((target("sse2"))) static void tigrBlendSSE2(TPixel *td, const TPixel *ts, int w, int xr, int xg, int xb, int xa)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i tint = _mm_setr_epi16(xr, xg, xb, 256, xr, xg, xb, 256);
+	__m128i alpha = _mm_set1_epi16(xa);
+	__m128i fullTint = _mm_set1_epi16(xa == 256 ? -1 : 0);
+	int x = 0;
+	for (; x + 4 <= w; x += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i *)(ts + x));
+		__m128i d = _mm_loadu_si128((const __m128i *)(td + x));
+		__m128i lo = tigrBlend2SSE2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), tint, alpha, fullTint);
+		__m128i hi = tigrBlend2SSE2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), tint, alpha, fullTint);
+		_mm_storeu_si128((__m128i *)(td + x), _mm_packus_epi16(lo, hi));
+	}
+	tigrBlendScalar(td + x, ts + x, w - x, xr, xg, xb, xa);
+}
+
+// Same as tigrBlend2SSE2 on four pixels (two per 128 bit lane).
+__attribute__((target("avx2"))) static inline __m256i tigrBlend4AVX2(__m256i s, __m256i d, __m256i tint, __m256i xa, __m256i fullTint)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i r = _mm256_srli_epi16(_mm256_mullo_epi16(s, tint), 8);
+	__m256i sa = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xff), 0xff);
+	__m256i e = _mm256_add_epi16(sa, _mm256_min_epi16(sa, _mm256_set1_epi16(1)));
+	__m256i a = _mm256_mullo_epi16(e, xa);
+	__m256i b = _mm256_sub_epi16(zero, a);
+
+	__m256i rl = _mm256_mullo_epi16(r, a), rh = _mm256_mulhi_epu16(r, a);
+	__m256i dl = _mm256_mullo_epi16(d, b), dh = _mm256_mulhi_epu16(d, b);
+	__m256i lo = _mm256_add_epi32(_mm256_unpacklo_epi16(rl, rh), _mm256_unpacklo_epi16(dl, dh));
+	__m256i hi = _mm256_add_epi32(_mm256_unpackhi_epi16(rl, rh), _mm256_unpackhi_epi16(dl, dh));
+	__m256i out = _mm256_packs_epi32(_mm256_srli_epi32(lo, 16), _mm256_srli_epi32(hi, 16));
+
+	__m256i keep = _mm256_cmpeq_epi16(a, zero);
+	__m256i take = _mm256_and_si256(_mm256_cmpeq_epi16(e, _mm256_set1_epi16(256)), fullTint);
+	out = _mm256_blendv_epi8(out, d, keep);
+	out = _mm256_blendv_epi8(out, r, take);
+	return out;
+}
+
+__attribute__((target("avx2"))) static void tigrBlendAVX2(TPixel *td, const TPixel *ts, int w, int xr, int xg, int xb, int xa)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i tint = _mm256_setr_epi16(xr, xg, xb, 256, xr, xg, xb, 256, xr, xg, xb, 256, xr, xg, xb, 256);
+	__m256i alpha = _mm256_set1_epi16(xa);
+	__m256i fullTint = _mm256_set1_epi16(xa == 256 ? -1 : 0);
+	int x = 0;
+	for (; x + 8 <= w; x += 8)
+	{
+		__m256i s = _mm256_loadu_si256((const __m256i *)(ts + x));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(td + x));
+		__m256i lo = tigrBlend4AVX2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero), tint, alpha, fullTint);
+		__m256i hi = tigrBlend4AVX2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero), tint, alpha, fullTint);
+		_mm256_storeu_si256((__m256i *)(td + x), _mm256_packus_epi16(lo, hi));
+	}
+	tigrBlendSSE2(td + x, ts + x, w - x, xr, xg, xb, xa);
+}
+#endif // TIGR_SIMD_X86
+
+// Picks the widest kernels the CPU supports, once.
+static TigrFillRow tigrFillKernel;
+static TigrBlendRow tigrBlendKernel;
+static TigrAlphaRun tigrAlphaRunKernel;
+
+static int tigrKernelSelect()
+{
+	TigrFillRow fill = tigrFillScalar;
+	TigrAlphaRun alphaRun = tigrAlphaRunScalar;
+	TigrBlendRow blend = tigrBlendScalar;
+#ifdef TIGR_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+	{
+		fill = tigrFillSSE2;
+		alphaRun = tigrAlphaRunSSE2;
+		blend = tigrBlendSSE2;
+	}
+	if (__builtin_cpu_supports("avx2"))
+	{
+		fill = tigrFillAVX2;
+		blend = tigrBlendAVX2;
+	}
+#endif
+	tigrFillKernel = fill;
+	tigrAlphaRunKernel = alphaRun;
+	tigrBlendKernel = blend; // Last, it marks the kernels as selected
+	return 1;
+}
+
+static void tigrKernelInit()
+{
+	// Static initialization is thread-safe, a caller on any thread sees every kernel selected.
+	static const int selected = tigrKernelSelect();
+	(void)selected;
+}
+
 Tigr *tigrBitmap2(int w, int h, int extra)
 {
 	Tigr *tigr = (Tigr *)calloc(1, sizeof(Tigr) + extra);
@@ -324,16 +607,15 @@ void tigrPosition(Tigr *bmp, int scale, int windowW, int windowH, int out[4])
 
 void tigrClear(Tigr *bmp, TPixel color)
 {
-	int count = bmp->w * bmp->h;
-	int n;
-	for (n = 0; n < count; n++)
-		bmp->pix[n] = color;
+	// The rows are contiguous, so the whole bitmap is one long row.
+	tigrKernelInit();
+	tigrFillKernel(bmp->pix, bmp->w * bmp->h, color);
 }
 
 void tigrFill(Tigr *bmp, int x, int y, int w, int h, TPixel color)
 {
 	TPixel *td;
-	int dt, i;
+	int dt;
 
 	if (x < 0)
 	{
@@ -356,19 +638,101 @@ void tigrFill(Tigr *bmp, int x, int y, int w, int h, TPixel color)
 	if (w <= 0 || h <= 0)
 		return;
 
+	tigrKernelInit();
 	td = &bmp->pix[y * bmp->w + x];
 	dt = bmp->w;
 	do
 	{
-		for (i = 0; i < w; i++)
-			td[i] = color;
+		tigrFillKernel(td, w, color);
 		td += dt;
 	} while (--h);
 }
 
+// Draws pixels with the same blend as tigrPlot, without checking bounds.
+// Opaque colors are written as is, which is what the blend gives for them.
+static void tigrPlotSpan(TPixel *td, int count, int stride, TPixel pix)
+{
+	int a, n;
+	if (pix.a == 255)
+	{
+		for (n = 0; n < count; n++, td += stride)
+			*td = pix;
+		return;
+	}
+	if (pix.a == 0)
+		return;
+
+	a = EXPAND(pix.a) * EXPAND(pix.a);
+	for (n = 0; n < count; n++, td += stride)
+	{
+		td->r += (unsigned char)((pix.r - td->r) * a >> 16);
+		td->g += (unsigned char)((pix.g - td->g) * a >> 16);
+		td->b += (unsigned char)((pix.b - td->b) * a >> 16);
+		td->a += (unsigned char)((pix.a - td->a) * a >> 16);
+	}
+}
+
+// Plots x0..x1 (inclusive, either order) on row y, clipped to the bitmap.
+static void tigrHLine(Tigr *bmp, int x0, int x1, int y, TPixel color)
+{
+	int t;
+	if (x0 > x1)
+	{
+		t = x0;
+		x0 = x1;
+		x1 = t;
+	}
+	if (y < 0 || y >= bmp->h || x1 < 0 || x0 >= bmp->w)
+		return;
+	if (x0 < 0)
+		x0 = 0;
+	if (x1 >= bmp->w)
+		x1 = bmp->w - 1;
+
+	if (color.a == 255)
+	{
+		tigrKernelInit();
+		tigrFillKernel(&bmp->pix[y * bmp->w + x0], x1 - x0 + 1, color);
+	}
+	else
+		tigrPlotSpan(&bmp->pix[y * bmp->w + x0], x1 - x0 + 1, 1, color);
+}
+
+// Plots y0..y1 (inclusive, either order) on column x, clipped to the bitmap.
+static void tigrVLine(Tigr *bmp, int x, int y0, int y1, TPixel color)
+{
+	int t;
+	if (y0 > y1)
+	{
+		t = y0;
+		y0 = y1;
+		y1 = t;
+	}
+	if (x < 0 || x >= bmp->w || y1 < 0 || y0 >= bmp->h)
+		return;
+	if (y0 < 0)
+		y0 = 0;
+	if (y1 >= bmp->h)
+		y1 = bmp->h - 1;
+
+	tigrPlotSpan(&bmp->pix[y0 * bmp->w + x], y1 - y0 + 1, bmp->w, color);
+}
+
 void tigrLine(Tigr *bmp, int x0, int y0, int x1, int y1, TPixel color)
 {
 	int sx, sy, dx, dy, err, e2;
+
+	// Horizontal and vertical lines are drawn as one span.
+	if (y0 == y1)
+	{
+		tigrHLine(bmp, x0, x1, y0, color);
+		return;
+	}
+	if (x0 == x1)
+	{
+		tigrVLine(bmp, x0, y0, y1, color);
+		return;
+	}
 	dx = abs(x1 - x0);
 	dy = abs(y1 - y0);
 	if (x0 < x1)
@@ -408,12 +772,13 @@ void tigrRect(Tigr *bmp, int x, int y, int w, int h, TPixel color)
 	if (w <= 0 || h <= 0)
 		return;
 
+	// Same four edges as before (each corner is plotted twice), as spans.
 	x1 = x + w - 1;
 	y1 = y + h - 1;
-	tigrLine(bmp, x, y, x1, y, color);
-	tigrLine(bmp, x1, y, x1, y1, color);
-	tigrLine(bmp, x1, y1, x, y1, color);
-	tigrLine(bmp, x, y1, x, y, color);
+	tigrHLine(bmp, x, x1, y, color);
+	tigrVLine(bmp, x1, y, y1, color);
+	tigrHLine(bmp, x1, x, y1, color);
+	tigrVLine(bmp, x, y1, y, color);
 }
 
 TPixel tigrGet(Tigr *bmp, int x, int y)
@@ -429,6 +794,13 @@ void tigrPlot(Tigr *bmp, int x, int y, TPixel pix)
 	int xa, i, a;
 	if (x >= 0 && y >= 0 && x < bmp->w && y < bmp->h)
 	{
+		// An opaque color replaces the pixel.
+		if (pix.a == 255)
+		{
+			bmp->pix[y * bmp->w + x] = pix;
+			return;
+		}
+
 		xa = EXPAND(pix.a);
 		i = y * bmp->w + x;
 
@@ -461,7 +833,7 @@ void tigrBlit(Tigr *dst, Tigr *src, int dx, int dy, int sx, int sy, int w, int h
 void tigrBlitTint(Tigr *dst, Tigr *src, int dx, int dy, int sx, int sy, int w, int h, TPixel tint)
 {
 	TPixel *td, *ts;
-	int x, st, dt, xr, xg, xb, xa;
+	int x, end, n, run, next, st, dt, xr, xg, xb, xa, copyOpaque;
 	CLIP();
 
 	xr = EXPAND(tint.r);
@@ -469,22 +841,46 @@ void tigrBlitTint(Tigr *dst, Tigr *src, int dx, int dy, int sx, int sy, int w, i
 	xb = EXPAND(tint.b);
 	xa = EXPAND(tint.a);
 
+	// A fully transparent tint leaves dst unchanged.
+	if (xa == 0)
+		return;
+
+	// With a white, opaque tint an opaque source pixel is copied as is.
+	copyOpaque = xr == 256 && xg == 256 && xb == 256 && xa == 256;
+	tigrKernelInit();
+
 	ts = &src->pix[sy * src->w + sx];
 	td = &dst->pix[dy * dst->w + dx];
 	st = src->w;
 	dt = dst->w;
 	do
 	{
-		for (x = 0; x < w; x++)
+		// Split the row into runs of blocks with the same opacity: transparent runs are
+		// skipped, opaque ones copied when copyOpaque is set, and the rest blended.
+		x = 0;
+		while (x < w)
 		{
-			unsigned r = (xr * ts[x].r) >> 8;
-			unsigned g = (xg * ts[x].g) >> 8;
-			unsigned b = (xb * ts[x].b) >> 8;
-			unsigned a = xa * EXPAND(ts[x].a);
-			td[x].r += (unsigned char)((r - td[x].r) * a >> 16);
-			td[x].g += (unsigned char)((g - td[x].g) * a >> 16);
-			td[x].b += (unsigned char)((b - td[x].b) * a >> 16);
-			td[x].a += (unsigned char)((ts[x].a - td[x].a) * a >> 16);
+			n = w - x < TIGR_RUN_BLOCK ? w - x : TIGR_RUN_BLOCK;
+			run = tigrAlphaRunKernel(ts + x, n);
+			if (run == TIGR_RUN_OPAQUE && !copyOpaque)
+				run = TIGR_RUN_MIXED;
+			end = x + n;
+			while (end < w)
+			{
+				n = w - end < TIGR_RUN_BLOCK ? w - end : TIGR_RUN_BLOCK;
+				next = tigrAlphaRunKernel(ts + end, n);
+				if (next == TIGR_RUN_OPAQUE && !copyOpaque)
+					next = TIGR_RUN_MIXED;
+				if (next != run)
+					break;
+				end += n;
+			}
+
+			if (run == TIGR_RUN_OPAQUE)
+				memcpy(td + x, ts + x, (end - x) * sizeof(TPixel));
+			else if (run == TIGR_RUN_MIXED)
+				tigrBlendKernel(td + x, ts + x, end - x, xr, xg, xb, xa);
+			x = end;
 		}
 		ts += st;
 		td += dt;
@@ -510,6 +906,8 @@ void tigrBlitAlpha(Tigr *dst, Tigr *src, int dx, int dy, int sx, int sy, int w,
 #include <string.h>
 #include <errno.h>
 
+static int tigrInflatePieces(void *out, unsigned outlen, const unsigned char *const *pieces, const unsigned *lengths, int count);
+
 typedef struct
 {
 	const unsigned char *p, *end;
@@ -523,12 +921,14 @@ static unsigned get32(const unsigned char *v)
 static const unsigned char *find(PNG *png, const char *chunk, unsigned minlen)
 {
 	const unsigned char *start;
-	while (png->p < png->end)
+	while (png->end - png->p >= 12)
 	{
 		unsigned len = get32(png->p + 0);
+		if (len > (unsigned)(png->end - png->p - 12))
+			break; // Truncated
 		start = png->p;
 		png->p += len + 12;
-		if (memcmp(start + 4, chunk, 4) == 0 && len >= minlen && png->p <= png->end)
+		if (memcmp(start + 4, chunk, 4) == 0 && len >= minlen)
 			return start + 8;
 	}
 
@@ -549,103 +949,81 @@ static int rowBytes(int w, int bipp)
 	return rowBits / 8 + ((rowBits % 8) ? 1 : 0);
 }
 
-static int unfilter(int w, int h, int bipp, unsigned char *raw)
+// Undoes one row's PNG filter, from raw into cur. cur and prev each have bpp zero
+// bytes in front, so the left neighbours of the first pixel need no special case.
+static int unfilterRow(int filter, int len, int bpp, const unsigned char *raw, unsigned char *cur, const unsigned char *prev)
 {
-	int len = rowBytes(w, bipp);
-	int bpp = rowBytes(1, bipp);
-	int x, y;
-	unsigned char *first = (unsigned char *)malloc(len + 1);
-	memset(first, 0, len + 1);
-	unsigned char *prev = first;
-	for (y = 0; y < h; y++, prev = raw, raw += len)
-	{
-#define LOOP(A, B)            \
-	for (x = 0; x < bpp; x++) \
-		raw[x] += A;          \
-	for (; x < len; x++)      \
-		raw[x] += B;          \
-	break
-		switch (*raw++)
-		{
-		case 0:
-			break;
-		case 1:
-			LOOP(0, raw[x - bpp]);
-		case 2:
-			LOOP(prev[x], prev[x]);
-		case 3:
-			LOOP(prev[x] / 2, (raw[x - bpp] + prev[x]) / 2);
-		case 4:
-			LOOP(prev[x], paeth(raw[x - bpp], prev[x], prev[x - bpp]));
-		default:
-			return 0;
-		}
-#undef LOOP
+	int x;
+	switch (filter)
+	{
+	case 0:
+		memcpy(cur, raw, len);
+		break;
+	case 1:
+		for (x = 0; x < len; x++)
+			cur[x] = raw[x] + cur[x - bpp];
+		break;
+	case 2:
+		for (x = 0; x < len; x++)
+			cur[x] = raw[x] + prev[x];
+		break;
+	case 3:
+		for (x = 0; x < len; x++)
+			cur[x] = raw[x] + (cur[x - bpp] + prev[x]) / 2;
+		break;
+	case 4:
+		for (x = 0; x < len; x++)
+			cur[x] = raw[x] + paeth(cur[x - bpp], prev[x], prev[x - bpp]);
+		break;
+	default:
+		return 0;
 	}
-	free(first);
 	return 1;
 }
 
-static void convert(
-	int bypp, int w, int h, const unsigned char *src, TPixel *dest,
-	const unsigned char *trns)
+static void convertRow(int bypp, int w, const unsigned char *src, TPixel *dest, const unsigned char *trns)
 {
-	int x, y;
-	for (y = 0; y < h; y++)
+	int x;
+	switch (bypp)
 	{
-		src++; // skip filter byte
-		for (x = 0; x < w; x++, src += bypp)
+	case 1:
+		for (x = 0; x < w; x++, src++)
 		{
-			switch (bypp)
-			{
-			case 1:
-			{
-				unsigned char c = src[0];
-				if (trns && c == *trns)
-				{
-					*dest++ = tigrRGBA(c, c, c, 0);
-					break;
-				}
-				else
-				{
-					*dest++ = tigrRGB(c, c, c);
-					break;
-				}
-			}
-			case 2:
-				*dest++ = tigrRGBA(src[0], src[0], src[0], src[1]);
-				break;
-			case 3:
-			{
-				unsigned char r = src[0];
-				unsigned char g = src[1];
-				unsigned char b = src[2];
-				if (trns && trns[1] == r && trns[3] == g && trns[5] == b)
-				{
-					*dest++ = tigrRGBA(r, g, b, 0);
-					break;
-				}
-				else
-				{
-					*dest++ = tigrRGB(r, g, b);
-					break;
-				}
-			}
-			case 4:
-				*dest++ = tigrRGBA(src[0], src[1], src[2], src[3]);
-				break;
-			}
+			unsigned char c = src[0];
+			*dest++ = tigrRGBA(c, c, c, trns && c == *trns ? 0 : 0xff);
+		}
+		break;
+	case 2:
+		for (x = 0; x < w; x++, src += 2)
+			*dest++ = tigrRGBA(src[0], src[0], src[0], src[1]);
+		break;
+	case 3:
+		for (x = 0; x < w; x++, src += 3)
+		{
+			unsigned char r = src[0];
+			unsigned char g = src[1];
+			unsigned char b = src[2];
+			if (trns && trns[1] == r && trns[3] == g && trns[5] == b)
+				*dest++ = tigrRGBA(r, g, b, 0);
+			else
+				*dest++ = tigrRGB(r, g, b);
 		}
+		break;
+	case 4:
+		// Same byte order as TPixel.
+		memcpy(dest, src, w * sizeof(TPixel));
+		break;
 	}
 }
 
-static void depalette(
-	int w, int h, unsigned char *src, TPixel *dest, int bipp,
-	const unsigned char *plte, const unsigned char *trns, int trnsSize)
+// Returns 0 if an index is past the end of the palette.
+static int depaletteRow(
+	int w, const unsigned char *src, TPixel *dest, int bipp,
+	const unsigned char *plte, int plteSize, const unsigned char *trns, int trnsSize)
 {
-	int x, y, c;
+	int x, c;
 	unsigned char alpha;
-	int mask, len;
+	int mask = 0, len = 0;
 
 	switch (bipp)
 	{
@@ -662,32 +1040,66 @@ static void depalette(
 		len = 7;
 	}
 
-	for (y = 0; y < h; y++)
+	for (x = 0; x < w; x++)
 	{
-		src++; // skip filter byte
-		for (x = 0; x < w; x++)
+		if (bipp == 8)
 		{
-			if (bipp == 8)
-			{
-				c = *src++;
-			}
-			else
-			{
-				int pos = x & len;
-				c = (src[0] >> ((len - pos) * bipp)) & mask;
-				if (pos == len)
-				{
-					src++;
-				}
-			}
-			alpha = 255;
-			if (c < trnsSize)
+			c = *src++;
+		}
+		else
+		{
+			int pos = x & len;
+			c = (src[0] >> ((len - pos) * bipp)) & mask;
+			if (pos == len)
 			{
-				alpha = trns[c];
+				src++;
 			}
-			*dest++ = tigrRGBA(plte[c * 3 + 0], plte[c * 3 + 1], plte[c * 3 + 2], alpha);
 		}
+		if (c >= plteSize)
+		{
+			return 0;
+		}
+		alpha = 255;
+		if (c < trnsSize)
+		{
+			alpha = trns[c];
+		}
+		*dest++ = tigrRGBA(plte[c * 3 + 0], plte[c * 3 + 1], plte[c * 3 + 2], alpha);
+	}
+	return 1;
+}
+
+// Unfilters and converts the inflated rows at raw into the bitmap, one row at a time
+// while the row is in cache. raw may be the tail of bmp->pix: a row's pixels never
+// reach past the start of the next filtered row.
+static int unfilterConvert(Tigr *bmp, int bipp, const unsigned char *raw, const unsigned char *plte,
+						   int plteSize, const unsigned char *trns, int trnsSize)
+{
+	int len = rowBytes(bmp->w, bipp);
+	int bpp = rowBytes(1, bipp);
+	int y, ok = 1;
+	unsigned char *rows, *cur, *prev, *swap;
+
+	rows = (unsigned char *)calloc(2, bpp + len);
+	if (!rows)
+		return 0;
+	prev = rows + bpp;
+	cur = prev + len + bpp;
+
+	for (y = 0; y < bmp->h && ok; y++, raw += len + 1)
+	{
+		ok = unfilterRow(raw[0], len, bpp, raw + 1, cur, prev);
+		if (ok && plte)
+			ok = depaletteRow(bmp->w, cur, bmp->pix + y * bmp->w, bipp, plte, plteSize, trns, trnsSize);
+		else if (ok)
+			convertRow(bipp / 8, bmp->w, cur, bmp->pix + y * bmp->w, trns);
+		swap = prev;
+		prev = cur;
+		cur = swap;
 	}
+
+	free(rows);
+	return ok;
 }
 
 #define FAIL()          \
@@ -707,13 +1119,16 @@ static int outsize(Tigr *bmp, int bipp)
 static Tigr *tigrLoadPng(PNG *png)
 {
 	const unsigned char *ihdr, *idat, *plte, *trns, *first;
-	int trnsSize = 0;
+	int plteSize = 0, trnsSize = 0;
 	int depth, ctype, bipp;
-	int datalen = 0;
-	unsigned char *data = NULL, *out;
+	unsigned datalen = 0, skip;
+	const unsigned char **pieces = NULL;
+	unsigned *lengths = NULL;
+	int count = 0, capacity = 0, n;
+	unsigned char header[2], *out;
 	Tigr *bmp = NULL;
 
-	CHECK(memcmp(png->p, "\211PNG\r\n\032\n", 8) == 0); // PNG signature
+	CHECK(png->end - png->p >= 8 && memcmp(png->p, "\211PNG\r\n\032\n", 8) == 0); // PNG signature
 	png->p += 8;
 	first = png->p;
 
@@ -752,56 +1167,89 @@ static Tigr *tigrLoadPng(PNG *png)
 	// No interlacing, or wacky filter types.
 	CHECK((depth != 16) && ihdr[10] == 0 && ihdr[11] == 0 && ihdr[12] == 0);
 
-	// Join IDAT chunks.
+	// Collect IDAT chunks, they are inflated in place rather than joined.
 	for (idat = find(png, "IDAT", 0); idat; idat = find(png, "IDAT", 0))
 	{
 		unsigned len = get32(idat - 8);
-		data = (unsigned char *)realloc(data, datalen + len);
-		if (!data)
-			break;
-
-		memcpy(data + datalen, idat, len);
+		if (count == capacity)
+		{
+			const unsigned char **morePieces;
+			unsigned *moreLengths;
+			capacity = capacity ? capacity * 2 : 16;
+			morePieces = (const unsigned char **)realloc(pieces, capacity * sizeof(*pieces));
+			CHECK(morePieces);
+			pieces = morePieces;
+			moreLengths = (unsigned *)realloc(lengths, capacity * sizeof(*lengths));
+			CHECK(moreLengths);
+			lengths = moreLengths;
+		}
+		pieces[count] = idat;
+		lengths[count++] = len;
 		datalen += len;
 	}
 
 	// Find palette.
 	png->p = first;
 	plte = find(png, "PLTE", 0);
+	if (plte)
+	{
+		plteSize = get32(plte - 8) / 3;
+	}
 
-	// Find transparency info.
+	// Find transparency info, a grey or RGB key too short for its color type is ignored.
 	png->p = first;
 	trns = find(png, "tRNS", 0);
 	if (trns)
 	{
 		trnsSize = get32(trns - 8);
+		if ((ctype == 0 && trnsSize < 2) || (ctype == 2 && trnsSize < 6))
+			trns = NULL;
 	}
 
-	CHECK(data && datalen >= 6);
-	CHECK((data[0] & 0x0f) == 0x08	  // compression method (RFC 1950)
-		  && (data[0] & 0xf0) <= 0x70 // window size
-		  && (data[1] & 0x20) == 0);  // preset dictionary present
+	CHECK(count > 0 && datalen >= 6);
+
+	// Leave the Adler-32 checksum at the end out of the deflate stream.
+	skip = 4;
+	while (skip > lengths[count - 1])
+		skip -= lengths[--count];
+	lengths[count - 1] -= skip;
+
+	// Read the zlib header, which may be split too.
+	for (n = 0, skip = 0; skip < 2;)
+	{
+		if (lengths[n] == 0)
+		{
+			n++;
+			continue;
+		}
+		header[skip++] = *pieces[n]++;
+		lengths[n]--;
+	}
+	CHECK((header[0] & 0x0f) == 0x08	// compression method (RFC 1950)
+		  && (header[0] & 0xf0) <= 0x70 // window size
+		  && (header[1] & 0x20) == 0);	// preset dictionary present
 
 	out = (unsigned char *)bmp->pix + outsize(bmp, 32) - outsize(bmp, bipp);
-	CHECK(tigrInflate(out, outsize(bmp, bipp), data + 2, datalen - 6));
-	CHECK(unfilter(bmp->w, bmp->h, bipp, out));
+	CHECK(tigrInflatePieces(out, outsize(bmp, bipp), pieces, lengths, count));
 
 	if (ctype == 3)
 	{
 		CHECK(plte);
-		depalette(bmp->w, bmp->h, out, bmp->pix, bipp, plte, trns, trnsSize);
 	}
 	else
 	{
 		CHECK(bipp % 8 == 0);
-		convert(bipp / 8, bmp->w, bmp->h, out, bmp->pix, trns);
+		plte = NULL;
 	}
+	CHECK(unfilterConvert(bmp, bipp, out, plte, plteSize, trns, trnsSize));
 
-	free(data);
+	free(pieces);
+	free(lengths);
 	return bmp;
 
 err:
-	if (data)
-		free(data);
+	free(pieces);
+	free(lengths);
 	if (bmp)
 		tigrFree(bmp);
 	return NULL;
@@ -1054,16 +1502,35 @@ int tigrSaveImage(const char *fileName, Tigr *bmp)
 
 // #include "tigr_internal.h"
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <setjmp.h>
 
+// Codes up to this many bits are decoded with one table lookup.
+#define FAST_BITS 10
+
+// Canonical Huffman code, see build().
+typedef struct
+{
+	uint16_t fast[1 << FAST_BITS]; // (length << 9) | symbol for codes of FAST_BITS or less, 0 for longer codes
+	uint16_t firstCode[17];		   // First code of each length
+	uint16_t firstSlot[17];		   // Slot in symbols of that code
+	uint32_t maxCode[17];		   // Codes of each length are below this, left aligned to 16 bits
+	uint16_t symbols[288];		   // Symbols in code order
+} Huffman;
+
 typedef struct
 {
-	unsigned bits, count;
+	uint64_t bits; // Bit buffer, next bit lowest
+	unsigned count; // Bits in the buffer
+	unsigned pad;	// Zero bytes fed in after the end of the input
 	const unsigned char *in, *inend;
-	unsigned char *out, *outend;
+	const unsigned char *const *pieces; // Input may be split up, e.g. into PNG IDAT chunks
+	const unsigned *lengths;
+	int piece, pieceCount;
+	unsigned char *outstart, *out, *outend;
 	jmp_buf jmp;
-	unsigned litcodes[288], distcodes[32], lencodes[19];
-	int tlit, tdist, tlen;
+	Huffman lit, dist, len;
 } State;
 
 #define FAIL() longjmp(s->jmp, 1)
@@ -1087,106 +1554,185 @@ static const unsigned char reverseTable[256] = {
 
 static unsigned rev16(unsigned n) { return (reverseTable[n & 0xff] << 8) | reverseTable[(n >> 8) & 0xff]; }
 
-static int bits(State *s, int n)
+// Moves on to the next piece of input, returns 0 if there are no more.
+static int nextPiece(State *s)
 {
-	int v = s->bits & ((1 << n) - 1);
-	s->bits >>= n;
-	s->count -= n;
-	while (s->count < 16)
+	while (s->piece + 1 < s->pieceCount)
 	{
-		CHECK(s->in != s->inend);
-		s->bits |= (*s->in++) << s->count;
-		s->count += 8;
+		s->piece++;
+		s->in = s->pieces[s->piece];
+		s->inend = s->in + s->lengths[s->piece];
+		if (s->in != s->inend)
+			return 1;
 	}
-	return v;
+	return 0;
 }
 
-static unsigned char *emit(State *s, int len)
+// Fills the bit buffer to at least 56 bits. Past the end of the input it reads
+// zeros, tigrInflate checks none of them were used.
+static void refill(State *s)
 {
-	s->out += len;
-	CHECK(s->out <= s->outend);
-	return s->out - len;
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	if (s->inend - s->in >= 8)
+	{
+		// Load 8 bytes, and keep as many whole bytes as fit.
+		uint64_t v;
+		memcpy(&v, s->in, 8);
+		s->bits |= v << s->count;
+		s->in += (63 - s->count) >> 3;
+		s->count |= 56;
+		return;
+	}
+#endif
+	while (s->count <= 56)
+	{
+		if (s->in == s->inend && !nextPiece(s))
+		{
+			CHECK(++s->pad <= 8);
+			s->count += 8;
+			continue;
+		}
+		s->bits |= (uint64_t)(*s->in++) << s->count;
+		s->count += 8;
+	}
 }
 
-static void copy(State *s, const unsigned char *src, int len)
+static int bits(State *s, int n)
 {
-	unsigned char *dest = emit(s, len);
-	while (len--)
-		*dest++ = *src++;
+	int v;
+	if (s->count < (unsigned)n)
+		refill(s);
+	v = (int)(s->bits & ((1u << n) - 1));
+	s->bits >>= n;
+	s->count -= n;
+	return v;
 }
 
-static int build(State *s, unsigned *tree, unsigned char *lens, int symcount)
+// Builds the lookup tables for a canonical Huffman code from its code lengths,
+// returns 0 if the lengths do not make a valid code.
+static int build(Huffman *h, const unsigned char *lens, int symcount)
 {
-	int n, codes[16], first[16], counts[16] = {0};
+	int n, code, slot, counts[16] = {0}, next[16];
 
-	// Frequency count.
 	for (n = 0; n < symcount; n++)
 		counts[lens[n]]++;
+	counts[0] = 0;
 
-	// Distribute codes.
-	counts[0] = codes[0] = first[0] = 0;
+	code = slot = 0;
 	for (n = 1; n <= 15; n++)
 	{
-		codes[n] = (codes[n - 1] + counts[n - 1]) << 1;
-		first[n] = first[n - 1] + counts[n - 1];
+		next[n] = code;
+		h->firstCode[n] = (uint16_t)code;
+		h->firstSlot[n] = (uint16_t)slot;
+		code += counts[n];
+		if (code > (1 << n))
+			return 0; // Over-subscribed
+		h->maxCode[n] = code << (16 - n);
+		code <<= 1;
+		slot += counts[n];
 	}
-	CHECK(first[15] + counts[15] <= symcount);
+	h->maxCode[16] = 0x10000;
 
-	// Insert keys into the tree for each symbol.
+	memset(h->fast, 0, sizeof(h->fast));
 	for (n = 0; n < symcount; n++)
 	{
 		int len = lens[n];
-		if (len != 0)
-		{
-			int code = codes[len]++, slot = first[len]++;
-			tree[slot] = (code << (32 - len)) | (n << 4) | len;
+		if (len == 0)
+			continue;
+
+		h->symbols[next[len] - h->firstCode[len] + h->firstSlot[len]] = (uint16_t)n;
+		if (len <= FAST_BITS)
+		{
+			// Every FAST_BITS pattern that starts with this code (bits arrive lowest first).
+			int j = rev16(next[len]) >> (16 - len);
+			for (; j < (1 << FAST_BITS); j += 1 << len)
+				h->fast[j] = (uint16_t)((len << 9) | n);
 		}
+		next[len]++;
 	}
-
-	return first[15];
+	return 1;
 }
 
-static int decode(State *s, unsigned tree[], int max)
+// Decodes one symbol, needs 15 bits in the buffer.
+static int decode(State *s, const Huffman *h)
 {
-	// Find the next prefix code.
-	unsigned lo = 0, hi = max, key;
-	unsigned search = (rev16(s->bits) << 16) | 0xffff;
-	while (lo < hi)
+	unsigned entry = h->fast[s->bits & ((1 << FAST_BITS) - 1)];
+	int len, slot;
+	unsigned key;
+
+	if (entry)
 	{
-		unsigned guess = (lo + hi) / 2;
-		if (search < tree[guess])
-			hi = guess;
-		else
-			lo = guess + 1;
+		s->bits >>= entry >> 9;
+		s->count -= entry >> 9;
+		return entry & 511;
 	}
 
-	// Pull out the key and check it.
-	key = tree[lo - 1];
-	CHECK(((search ^ key) >> (32 - (key & 0xf))) == 0);
-
-	bits(s, key & 0xf);
-	return (key >> 4) & 0xfff;
+	// Longer code, find its length by comparing against each length's range.
+	key = rev16((unsigned)s->bits & 0xffff);
+	for (len = FAST_BITS + 1; key >= h->maxCode[len]; len++)
+		;
+	CHECK(len <= 15);
+	slot = (int)(key >> (16 - len)) - h->firstCode[len] + h->firstSlot[len];
+	s->bits >>= len;
+	s->count -= len;
+	return h->symbols[slot];
 }
 
-static void run(State *s, int sym)
+static void copy(State *s, int offs, int len)
 {
-	int length = bits(s, lenBits[sym]) + lenBase[sym];
-	int dsym = decode(s, s->distcodes, s->tdist);
-	int offs = bits(s, distBits[dsym]) + distBase[dsym];
-	copy(s, s->out - offs, length);
+	unsigned char *dest = s->out;
+	const unsigned char *src = dest - offs;
+	CHECK(offs <= s->out - s->outstart && len <= s->outend - s->out);
+	s->out += len;
+
+	if (offs >= len)
+	{
+		memcpy(dest, src, len);
+	}
+	else if (offs == 1)
+	{
+		memset(dest, *src, len);
+	}
+	else
+	{
+		while (len--)
+			*dest++ = *src++;
+	}
 }
 
-static void block(State *s)
+static void block(State *s, const Huffman *lit, const Huffman *dist)
 {
 	for (;;)
 	{
-		int sym = decode(s, s->litcodes, s->tlit);
+		int sym, length, dsym, offs;
+
+		// A length and distance need at most 15 + 5 + 15 + 13 bits.
+		if (s->count < 48)
+			refill(s);
+
+		sym = decode(s, lit);
 		if (sym < 256)
-			*emit(s, 1) = (unsigned char)sym;
-		else if (sym > 256)
-			run(s, sym - 257);
-		else
+		{
+			CHECK(s->out < s->outend);
+			*s->out++ = (unsigned char)sym;
+			continue;
+		}
+		if (sym == 256)
 			break;
+
+		sym -= 257;
+		CHECK(sym < 29);
+		length = lenBase[sym] + (int)(s->bits & ((1u << lenBits[sym]) - 1));
+		s->bits >>= lenBits[sym];
+		s->count -= lenBits[sym];
+
+		dsym = decode(s, dist);
+		CHECK(dsym < 30);
+		offs = distBase[dsym] + (int)(s->bits & ((1u << distBits[dsym]) - 1));
+		s->bits >>= distBits[dsym];
+		s->count -= distBits[dsym];
+
+		copy(s, offs, length);
 	}
 }
 
@@ -1196,19 +1742,41 @@ static void stored(State *s)
 	int len;
 	bits(s, s->count & 7);
 	len = bits(s, 16);
-	CHECK(((len ^ s->bits) & 0xffff) == 0xffff);
-	CHECK(s->in + len <= s->inend);
+	CHECK((len ^ bits(s, 16)) == 0xffff);
+	CHECK(len <= s->outend - s->out);
 
-	copy(s, s->in, len);
-	s->in += len;
-	bits(s, 16);
+	// Bytes already in the bit buffer first, then straight from the input.
+	while (len > 0 && s->count > 0)
+	{
+		*s->out++ = (unsigned char)bits(s, 8);
+		len--;
+	}
+	if (len > 0)
+		s->bits = 0; // The buffer is empty, drop bytes refill() read ahead
+	while (len > 0)
+	{
+		int n;
+		CHECK(s->in != s->inend || nextPiece(s));
+		n = (int)(s->inend - s->in);
+		n = n < len ? n : len;
+		memcpy(s->out, s->in, n);
+		s->out += n;
+		s->in += n;
+		len -= n;
+	}
 }
 
-static void fixed(State *s)
+typedef struct
+{
+	Huffman lit, dist;
+} FixedCodes;
+
+static FixedCodes buildFixed()
 {
 	// Fixed set of Huffman codes.
 	int n;
 	unsigned char lens[288 + 32];
+	FixedCodes codes;
 	for (n = 0; n <= 143; n++)
 		lens[n] = 8;
 	for (n = 144; n <= 255; n++)
@@ -1220,9 +1788,18 @@ static void fixed(State *s)
 	for (n = 0; n < 32; n++)
 		lens[288 + n] = 5;
 
-	// Build lit/dist trees.
-	s->tlit = build(s, s->litcodes, lens, 288);
-	s->tdist = build(s, s->distcodes, lens + 288, 32);
+	// Build lit/dist tables.
+	build(&codes.lit, lens, 288);
+	build(&codes.dist, lens + 288, 32);
+	return codes;
+}
+
+static void fixed(State *s)
+{
+	// Built on first use only, small PNGs often end in a fixed block. Static
+	// initialization is thread-safe, images may be decoded on loader threads.
+	static const FixedCodes codes = buildFixed();
+	block(s, &codes.lit, &codes.dist);
 }
 
 static void dynamic(State *s)
@@ -1232,29 +1809,43 @@ static void dynamic(State *s)
 	nlit = 257 + bits(s, 5);
 	ndist = 1 + bits(s, 5);
 	nlen = 4 + bits(s, 4);
+	CHECK(nlit <= 288 && ndist <= 32);
 	for (n = 0; n < nlen; n++)
-		lenlens[order[n]] = (unsigned char)bits(s, 3);
+		lenlens[(int)order[n]] = (unsigned char)bits(s, 3);
 
-	// Build the tree for decoding code lengths.
-	s->tlen = build(s, s->lencodes, lenlens, 19);
+	// Build the table for decoding code lengths.
+	CHECK(build(&s->len, lenlens, 19));
 
 	// Decode code lengths.
 	for (n = 0; n < nlit + ndist;)
 	{
-		int sym = decode(s, s->lencodes, s->tlen);
+		int sym;
+		if (s->count < 32)
+			refill(s);
+		sym = decode(s, &s->len);
 		switch (sym)
 		{
 		case 16:
+			CHECK(n > 0);
 			for (i = 3 + bits(s, 2); i; i--, n++)
+			{
+				CHECK(n < nlit + ndist);
 				lens[n] = lens[n - 1];
+			}
 			break;
 		case 17:
 			for (i = 3 + bits(s, 3); i; i--, n++)
+			{
+				CHECK(n < nlit + ndist);
 				lens[n] = 0;
+			}
 			break;
 		case 18:
 			for (i = 11 + bits(s, 7); i; i--, n++)
+			{
+				CHECK(n < nlit + ndist);
 				lens[n] = 0;
+			}
 			break;
 		default:
 			lens[n++] = (unsigned char)sym;
@@ -1262,24 +1853,34 @@ static void dynamic(State *s)
 		}
 	}
 
-	// Build lit/dist trees.
-	s->tlit = build(s, s->litcodes, lens, nlit);
-	s->tdist = build(s, s->distcodes, lens + nlit, ndist);
+	// Build lit/dist tables.
+	CHECK(build(&s->lit, lens, nlit));
+	CHECK(build(&s->dist, lens + nlit, ndist));
+	block(s, &s->lit, &s->dist);
 }
 
-int tigrInflate(void *out, unsigned outlen, const void *in, unsigned inlen)
+// Inflates a raw DEFLATE stream that is split into count pieces, without joining them.
+static int tigrInflatePieces(void *out, unsigned outlen, const unsigned char *const *pieces, const unsigned *lengths, int count)
 {
 	int last;
-	State *s = (State *)calloc(1, sizeof(State));
+	State *s = (State *)malloc(sizeof(State));
+	if (!s || count <= 0)
+	{
+		free(s);
+		return 0;
+	}
 
-	// We assume we can buffer 2 extra bytes from off the end of 'in'.
-	s->in = (unsigned char *)in;
-	s->inend = s->in + inlen + 2;
-	s->out = (unsigned char *)out;
+	s->pieces = pieces;
+	s->lengths = lengths;
+	s->piece = 0;
+	s->pieceCount = count;
+	s->in = pieces[0];
+	s->inend = s->in + lengths[0];
+	s->outstart = s->out = (unsigned char *)out;
 	s->outend = s->out + outlen;
 	s->bits = 0;
 	s->count = 0;
-	bits(s, 0);
+	s->pad = 0;
 
 	if (setjmp(s->jmp) == 1)
 	{
@@ -1297,23 +1898,31 @@ int tigrInflate(void *out, unsigned outlen, const void *in, unsigned inlen)
 			break;
 		case 1:
 			fixed(s);
-			block(s);
 			break;
 		case 2:
 			dynamic(s);
-			block(s);
 			break;
 		case 3:
 			FAIL();
 		}
 	} while (!last);
 
+	// The zeros read past the end of the input must all still be in the buffer.
+	CHECK(s->pad * 8 <= s->count);
+
 	free(s);
 	return 1;
 }
 
+int tigrInflate(void *out, unsigned outlen, const void *in, unsigned inlen)
+{
+	const unsigned char *piece = (const unsigned char *)in;
+	return tigrInflatePieces(out, outlen, &piece, &inlen, 1);
+}
+
 #undef CHECK
 #undef FAIL
+#undef FAST_BITS
 
 //////// End of inlined file: tigr_inflate.c ////////
 
@@ -1950,7 +2559,7 @@ TigrInternal *tigrInternal(Tigr *bmp)
 	return (TigrInternal *)(bmp + 1);
 }
 
-#ifdef _WIN32
+#if defined(_WIN32) && !defined(TIGR_HEADLESS)
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <shellapi.h>
@@ -2137,7 +2746,7 @@ void tigrUpdate(Tigr *bmp)
 	// Update the widget overlay.
 	tigrWinUpdateWidgets(bmp, dw, dh);
 
-	if (!tigrGAPIBegin(bmp))
+	if (tigrGAPINeedsPresent(bmp, dw, dh) && !tigrGAPIBegin(bmp))
 	{
 		tigrGAPIPresent(bmp, dw, dh);
 		SwapBuffers(win->gl.dc);
@@ -2155,6 +2764,8 @@ void tigrUpdate(Tigr *bmp)
 		TranslateMessage(&msg);
 		DispatchMessage(&msg);
 	}
+
+	tigrQueueChanges(bmp);
 }
 
 typedef BOOL(APIENTRY *PFNWGLSWAPINTERVALFARPROC_)(int);
@@ -2823,7 +3434,7 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 
 // #include "tigr_internal.h"
 
-#ifdef __APPLE__
+#if defined(__APPLE__) && !defined(TIGR_HEADLESS)
 #include <TargetConditionals.h>
 #ifdef TARGET_OS_MAC
 
@@ -3801,9 +4412,13 @@ void tigrUpdate(Tigr *bmp)
 		win->scale = tigrEnforceScale(tigrCalcScale(bmp->w, bmp->h, windowSize.width, windowSize.height), win->flags);
 
 	tigrPosition(bmp, win->scale, windowSize.width, windowSize.height, win->pos);
-	tigrGAPIPresent(bmp, windowSize.width, windowSize.height);
-	objc_msgSend_void(openGLContext, sel_registerName("flushBuffer"));
+	if (tigrGAPINeedsPresent(bmp, windowSize.width, windowSize.height))
+	{
+		tigrGAPIPresent(bmp, windowSize.width, windowSize.height);
+		objc_msgSend_void(openGLContext, sel_registerName("flushBuffer"));
+	}
 	tigrGAPIEnd(bmp);
+	tigrQueueChanges(bmp);
 }
 
 int tigrGAPIBegin(Tigr *bmp)
@@ -4007,7 +4622,7 @@ extern "C"
 
 // #include "tigr_internal.h"
 
-#if __linux__ && !__ANDROID__
+#if __linux__ && !__ANDROID__ && !defined(TIGR_HEADLESS)
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -4194,7 +4809,8 @@ Tigr *tigrWindow(int w, int h, const char *title, int flags)
 
 	cmap = XCreateColormap(dpy, root, vi->visual, AllocNone);
 	swa.colormap = cmap;
-	swa.event_mask = StructureNotifyMask;
+	swa.event_mask = StructureNotifyMask | FocusChangeMask | PointerMotionMask | ButtonPressMask | ButtonReleaseMask |
+					 KeyPressMask | KeyReleaseMask;
 
 	// Create window of wanted size
 	xwin = XCreateWindow(dpy, root, 0, 0, w * scale, h * scale, 0, vi->depth, InputOutput, vi->visual, CWColormap | CWEventMask, &swa);
@@ -4289,6 +4905,8 @@ Tigr *tigrWindow(int w, int h, const char *title, int flags)
 	win->widgetsScale = 0;
 	win->widgets = 0;
 	win->gl.gl_legacy = 0;
+	win->winWidth = w * scale;
+	win->winHeight = h * scale;
 
 	memset(win->keys, 0, 256);
 	memset(win->prev, 0, 256);
@@ -4535,19 +5153,11 @@ static void tigrUpdateModifiers(TigrInternal *win)
 	win->keys[TK_ALT] = win->keys[TK_LALT] || win->keys[TK_RALT];
 }
 
-static void tigrInterpretChar(TigrInternal *win, Window root, unsigned int keycode, unsigned int mask)
+static void tigrInterpretChar(TigrInternal *win, XKeyEvent *event)
 {
-	XKeyEvent event;
-	memset(&event, 0, sizeof(event));
-	event.type = KeyPress;
-	event.display = win->dpy;
-	event.root = root;
-	event.window = win->win;
-	event.state = mask;
-	event.keycode = keycode;
 	char inputTextUTF8[10];
 	Status status = 0;
-	Xutf8LookupString(win->ic, &event, inputTextUTF8, sizeof(inputTextUTF8), NULL, &status);
+	Xutf8LookupString(win->ic, event, inputTextUTF8, sizeof(inputTextUTF8), NULL, &status);
 
 	if (status == XLookupChars)
 	{
@@ -4555,116 +5165,168 @@ static void tigrInterpretChar(TigrInternal *win, Window root, unsigned int keyco
 	}
 }
 
-static void tigrProcessInput(TigrInternal *win, int winWidth, int winHeight)
+// Converts an X server timestamp (milliseconds) to tigrEventTime. Events are
+// read after they happen, so the smallest difference seen between the two
+// clocks is the closest to the real one.
+static double tigrEventTimeFromX11(TigrInternal *win, Time time)
 {
+	double offset = tigrEventTime() - time / 1000.0;
+	if (!win->timeOffsetSet || offset < win->timeOffset)
 	{
-		Window focused;
-		int revertTo;
-		XGetInputFocus(win->dpy, &focused, &revertTo);
-
-		if (win->win != focused)
-		{
-			return;
-		}
+		win->timeOffset = offset;
+		win->timeOffsetSet = 1;
 	}
+	return time / 1000.0 + win->timeOffset;
+}
 
-	Window root;
-	Window child;
-	int rootX;
-	int rootY;
-	int winX;
-	int winY;
-	unsigned int mask;
-
-	if (XQueryPointer(win->dpy, win->win, &root, &child, &rootX, &rootY, &winX, &winY, &mask))
+static int tigrButtonFromX11(unsigned int button)
+{
+	switch (button)
 	{
-		static unsigned int prevButtons;
-		unsigned int buttons = mask & (Button1Mask | Button2Mask | Button3Mask);
-
-		win->mouseX = (winX - win->pos[0]) / win->scale;
-		win->mouseY = (winY - win->pos[1]) / win->scale;
-
-		if (buttons != prevButtons && (winX > 0 && winX < winWidth) && (winY > 0 && winY < winHeight))
-		{
-			win->mouseButtons =
-				(buttons & Button1Mask) ? 1 : 0 | (buttons & Button3Mask) ? 2
-										  : 0 | (buttons & Button2Mask)	  ? 4
-																		  : 0;
-		}
-		prevButtons = buttons;
+	case Button1:
+		return 1;
+	case Button3:
+		return 2;
+	case Button2:
+		return 4;
 	}
+	return 0; // Wheel and extra buttons
+}
+
+// Reads every event waiting for the window. Input comes from the events
+// themselves, so nothing is pressed and released unseen between updates,
+// and an update with no input needs no round trip to the X server.
+static void tigrProcessInput(TigrInternal *win)
+{
+	XEvent event;
+	int button, key;
+	double time;
 
-	static char prevKeys[32];
-	char keys[32];
-	XQueryKeymap(win->dpy, keys);
-	for (int i = 0; i < 32; i++)
+	while (win->win && XPending(win->dpy))
 	{
-		char thisBlock = keys[i];
-		char prevBlock = prevKeys[i];
-		if (thisBlock != prevBlock)
+		XNextEvent(win->dpy, &event);
+		switch (event.type)
 		{
-			for (int j = 0; j < 8; j++)
+		case ConfigureNotify:
+			win->winWidth = event.xconfigure.width;
+			win->winHeight = event.xconfigure.height;
+			break;
+		case MotionNotify:
+			win->mouseX = (event.xmotion.x - win->pos[0]) / win->scale;
+			win->mouseY = (event.xmotion.y - win->pos[1]) / win->scale;
+			break;
+		case ButtonPress:
+		case ButtonRelease:
+			button = tigrButtonFromX11(event.xbutton.button);
+			if (!button)
+				break;
+			win->mouseX = (event.xbutton.x - win->pos[0]) / win->scale;
+			win->mouseY = (event.xbutton.y - win->pos[1]) / win->scale;
+			if (event.type == ButtonPress)
+				win->mouseButtons |= button;
+			else
+				win->mouseButtons &= ~button;
+			time = tigrEventTimeFromX11(win, event.xbutton.time);
+			tigrQueueEvent(win, &win->mouseEvents, event.type == ButtonPress ? TIGR_MOUSE_DOWN : TIGR_MOUSE_UP,
+						   win->mouseX, win->mouseY, button, time);
+			break;
+		case KeyPress:
+			tigrInterpretChar(win, &event.xkey);
+			key = tigrKeyFromX11(XkbKeycodeToKeysym(win->dpy, event.xkey.keycode, 0, 0));
+			if (!key || win->keys[key])
+				break;
+			win->keys[key] = 1;
+			tigrUpdateModifiers(win);
+			tigrQueueEvent(win, &win->keyEvents, TIGR_KEY_DOWN, 0, 0, key,
+						   tigrEventTimeFromX11(win, event.xkey.time));
+			break;
+		case KeyRelease:
+			// Auto-repeat sends a release and a press with the same time, the key is still held.
+			if (XEventsQueued(win->dpy, QueuedAfterReading))
 			{
-				int thisBit = thisBlock & 1;
-				int prevBit = prevBlock & 1;
-				thisBlock >>= 1;
-				prevBlock >>= 1;
-				if (thisBit != prevBit)
+				XEvent next;
+				XPeekEvent(win->dpy, &next);
+				if (next.type == KeyPress && next.xkey.time == event.xkey.time && next.xkey.keycode == event.xkey.keycode)
 				{
-					int keyCode = 8 * i + j;
-					KeySym keySym = XkbKeycodeToKeysym(win->dpy, keyCode, 0, 0);
-					if (keySym != NoSymbol)
-					{
-						int key = tigrKeyFromX11(keySym);
-						win->keys[key] = thisBit;
-						tigrUpdateModifiers(win);
-
-						if (thisBit)
-						{
-							tigrInterpretChar(win, root, keyCode, mask);
-						}
-					}
+					XNextEvent(win->dpy, &next);
+					tigrInterpretChar(win, &next.xkey);
+					break;
 				}
 			}
+			key = tigrKeyFromX11(XkbKeycodeToKeysym(win->dpy, event.xkey.keycode, 0, 0));
+			if (!key || !win->keys[key])
+				break;
+			win->keys[key] = 0;
+			tigrUpdateModifiers(win);
+			tigrQueueEvent(win, &win->keyEvents, TIGR_KEY_UP, 0, 0, key,
+						   tigrEventTimeFromX11(win, event.xkey.time));
+			break;
+		case FocusOut:
+			// Releases are not sent to a window without focus, so let go of everything now.
+			time = tigrEventTime();
+			for (key = 0; key < 256; key++)
+			{
+				if (win->keys[key])
+				{
+					win->keys[key] = 0;
+					tigrQueueEvent(win, &win->keyEvents, TIGR_KEY_UP, 0, 0, key, time);
+				}
+			}
+			for (button = 1; button <= 4; button <<= 1)
+			{
+				if (win->mouseButtons & button)
+					tigrQueueEvent(win, &win->mouseEvents, TIGR_MOUSE_UP, win->mouseX, win->mouseY, button, time);
+			}
+			win->mouseButtons = 0;
+			break;
+		case ClientMessage:
+			if ((Atom)event.xclient.data.l[0] == wmDeleteMessage)
+			{
+				glXMakeCurrent(win->dpy, None, NULL);
+				glXDestroyContext(win->dpy, win->glc);
+				XDestroyWindow(win->dpy, win->win);
+				win->win = 0;
+			}
+			break;
 		}
 	}
-	memcpy(prevKeys, keys, 32);
-
-	XEvent event;
-	while (XCheckTypedWindowEvent(win->dpy, win->win, ClientMessage, &event))
-	{
-		if (event.xclient.data.l[0] == wmDeleteMessage)
-		{
-			glXMakeCurrent(win->dpy, None, NULL);
-			glXDestroyContext(win->dpy, win->glc);
-			XDestroyWindow(win->dpy, win->win);
-			win->win = 0;
-		}
-	}
-	XFlush(win->dpy);
 }
 
 void tigrUpdate(Tigr *bmp)
 {
-	XWindowAttributes gwa;
-
 	TigrInternal *win = tigrInternal(bmp);
+	int width, height;
+	double pending, arrived;
 
 	memcpy(win->prev, win->keys, 256);
 
-	XGetWindowAttributes(win->dpy, win->win, &gwa);
+	// Input read here is only on screen after the next present, not the one
+	// below, so its time is held back until this frame has been presented.
+	pending = win->inputPending;
+	win->inputPending = 0;
+	tigrProcessInput(win);
+	arrived = win->inputPending;
+	win->inputPending = pending;
+	if (!win->win)
+		return;
 
+	width = win->winWidth;
+	height = win->winHeight;
 	if (win->flags & TIGR_AUTO)
-		tigrResize(bmp, gwa.width / win->scale, gwa.height / win->scale);
+		tigrResize(bmp, width / win->scale, height / win->scale);
 	else
-		win->scale = tigrEnforceScale(tigrCalcScale(bmp->w, bmp->h, gwa.width, gwa.height), win->flags);
-
-	tigrPosition(bmp, win->scale, gwa.width, gwa.height, win->pos);
-	glXMakeCurrent(win->dpy, win->win, win->glc);
-	tigrGAPIPresent(bmp, gwa.width, gwa.height);
-	glXSwapBuffers(win->dpy, win->win);
+		win->scale = tigrEnforceScale(tigrCalcScale(bmp->w, bmp->h, width, height), win->flags);
 
-	tigrProcessInput(win, gwa.width, gwa.height);
+	tigrPosition(bmp, win->scale, width, height, win->pos);
+	if (tigrGAPINeedsPresent(bmp, width, height))
+	{
+		glXMakeCurrent(win->dpy, win->win, win->glc);
+		tigrGAPIPresent(bmp, width, height);
+		glXSwapBuffers(win->dpy, win->win);
+	}
+	if (win->inputPending == 0)
+		win->inputPending = arrived;
+	XFlush(win->dpy);
 }
 
 void tigrFree(Tigr *bmp)
@@ -4687,6 +5349,7 @@ void tigrFree(Tigr *bmp)
 void tigrError(Tigr *bmp, const char *message, ...)
 {
 	char tmp[1024];
+	(void)bmp;
 
 	va_list args;
 	va_start(args, message);
@@ -5356,6 +6019,223 @@ void *tigrReadFile(const char *fileName, int *length)
 
 //////// End of inlined file: tigr_android.c ////////
 
+//////// Start of inlined file: tigr_headless.c ////////
+
+// #include "tigr_internal.h"
+
+#ifdef TIGR_HEADLESS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <chrono>
+
+// A headless window is an off-screen bitmap with a TigrInternal, so the
+// drawing and input functions work on it unchanged. Input comes from
+// tigrHeadlessScript and the tigrHeadless* setters instead of a display.
+Tigr *tigrWindow(int w, int h, const char *title, int flags)
+{
+	Tigr *bmp;
+	TigrInternal *win;
+	(void)title; // There is no title bar to show it in
+
+	bmp = tigrBitmap2(w, h, sizeof(TigrInternal));
+	bmp->handle = bmp;
+
+	win = tigrInternal(bmp);
+	win->shown = 1;
+	win->closed = 0;
+	win->scale = 1;
+	win->flags = flags;
+	win->widgetsScale = 0;
+	win->pos[0] = 0;
+	win->pos[1] = 0;
+	win->pos[2] = w;
+	win->pos[3] = h;
+	win->p1 = win->p2 = win->p3 = 0;
+	win->p4 = 1;
+	win->mouseX = -1;
+	win->mouseY = -1;
+
+	return bmp;
+}
+
+int tigrClosed(Tigr *bmp)
+{
+	TigrInternal *win = tigrInternal(bmp);
+	return win->closed;
+}
+
+void tigrUpdate(Tigr *bmp)
+{
+	TigrInternal *win = tigrInternal(bmp);
+
+	memcpy(win->prev, win->keys, 256);
+
+	// There is no texture to upload to, the bitmap is the screen.
+	win->damage[0] = win->damage[1] = win->damage[2] = win->damage[3] = 0;
+	tigrPresented(win);
+
+	if (win->script)
+		win->script(bmp, win->frame, win->scriptData);
+	win->frame++;
+	tigrQueueChanges(bmp);
+}
+
+void tigrFree(Tigr *bmp)
+{
+	free(bmp->pix);
+	free(bmp);
+}
+
+int tigrKeyDown(Tigr *bmp, int key)
+{
+	TigrInternal *win;
+	assert(key < 256);
+	win = tigrInternal(bmp);
+	return win->keys[key] && !win->prev[key];
+}
+
+int tigrKeyHeld(Tigr *bmp, int key)
+{
+	TigrInternal *win;
+	assert(key < 256);
+	win = tigrInternal(bmp);
+	return win->keys[key];
+}
+
+int tigrReadChar(Tigr *bmp)
+{
+	TigrInternal *win = tigrInternal(bmp);
+	int c = win->lastChar;
+	win->lastChar = 0;
+	return c;
+}
+
+std::vector<uint32_t> tigrKeyboardData(Tigr *bmp)
+{
+	// Return 8 uint32_t bitmasks representing key states (32 keys per uint32_t)
+	std::vector<uint32_t> data({0, 0, 0, 0, 0, 0, 0, 0});
+
+	TigrInternal *win;
+	if (!bmp || !bmp->handle)
+		return data;
+	win = tigrInternal(bmp);
+
+	for (int j = 0; j < 8; j++)
+	{
+		uint32_t num = 0;
+		for (int i = 0; i < 32; i++)
+		{
+			uint32_t bit = win->keys[i + 32 * j] ? 1u : 0u;
+			num |= (bit << i);
+		}
+		data[j] = num;
+	}
+
+	return data;
+}
+
+void tigrError(Tigr *bmp, const char *message, ...)
+{
+	char tmp[1024];
+	(void)bmp;
+
+	va_list args;
+	va_start(args, message);
+	vsnprintf(tmp, sizeof(tmp), message, args);
+	tmp[sizeof(tmp) - 1] = 0;
+	va_end(args);
+
+	printf("tigr fatal error: %s\n", tmp);
+
+	exit(1);
+}
+
+float tigrTime()
+{
+	static double lastTime = 0;
+
+	double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	double elapsed = lastTime == 0 ? 0 : now - lastTime;
+	lastTime = now;
+
+	return (float)elapsed;
+}
+
+void tigrMouse(Tigr *bmp, int *x, int *y, int *buttons)
+{
+	TigrInternal *win = tigrInternal(bmp);
+	if (x)
+	{
+		*x = win->mouseX;
+	}
+	if (y)
+	{
+		*y = win->mouseY;
+	}
+	if (buttons)
+	{
+		*buttons = win->mouseButtons;
+	}
+}
+
+int tigrTouch(Tigr *bmp, TigrTouchPoint *points, int maxPoints)
+{
+	int buttons = 0;
+	if (maxPoints > 0)
+	{
+		tigrMouse(bmp, &points[0].x, &points[0].y, &buttons);
+	}
+	return buttons ? 1 : 0;
+}
+
+void tigrHeadlessScript(Tigr *bmp, TigrInputScript script, void *userData)
+{
+	TigrInternal *win = tigrInternal(bmp);
+	win->script = script;
+	win->scriptData = userData;
+}
+
+void tigrHeadlessMouse(Tigr *bmp, int x, int y, int buttons)
+{
+	TigrInternal *win = tigrInternal(bmp);
+	win->mouseX = x;
+	win->mouseY = y;
+	win->mouseButtons = buttons;
+}
+
+void tigrHeadlessKey(Tigr *bmp, int key, int down)
+{
+	TigrInternal *win;
+	assert(key < 256);
+	win = tigrInternal(bmp);
+	win->keys[key] = down ? 1 : 0;
+}
+
+void tigrHeadlessChar(Tigr *bmp, int cp)
+{
+	TigrInternal *win = tigrInternal(bmp);
+	win->lastChar = cp;
+}
+
+void tigrHeadlessClose(Tigr *bmp)
+{
+	TigrInternal *win = tigrInternal(bmp);
+	win->closed = 1;
+}
+
+int tigrHeadlessFrame(Tigr *bmp)
+{
+	TigrInternal *win = tigrInternal(bmp);
+	return win->frame;
+}
+
+#endif // TIGR_HEADLESS
+
+//////// End of inlined file: tigr_headless.c ////////
+
 //////// Start of inlined file: tigr_gl.c ////////
 
 // #include "tigr_internal.h"
@@ -5733,10 +6613,44 @@ void tigrGAPIDestroy(Tigr *bmp)
 	}
 }
 
+// Copies a bitmap into its texture. The texture is only (re)allocated when the
+// bitmap size changes; otherwise just the damaged rectangle is sent, or nothing
+// when it is empty. A NULL damage sends the whole bitmap.
+void tigrGAPIUpload(GLuint tex, int *texW, int *texH, Tigr *bmp, const int *damage)
+{
+	int x0, y0, x1, y1;
+
+	glBindTexture(GL_TEXTURE_2D, tex);
+	if (*texW != bmp->w || *texH != bmp->h)
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, bmp->w, bmp->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, bmp->pix);
+		*texW = bmp->w;
+		*texH = bmp->h;
+		return;
+	}
+
+	if (!damage)
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, bmp->w, bmp->h, GL_RGBA, GL_UNSIGNED_BYTE, bmp->pix);
+		return;
+	}
+
+	x0 = damage[0];
+	y0 = damage[1];
+	x1 = damage[2];
+	y1 = damage[3];
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, bmp->w);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, x1 - x0, y1 - y0, GL_RGBA, GL_UNSIGNED_BYTE, bmp->pix + y0 * bmp->w + x0);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
 void tigrGAPIDraw(int legacy, GLuint uniform_model, GLuint tex, Tigr *bmp, int x1, int y1, int x2, int y2)
 {
+	(void)bmp; // Uploaded to tex before drawing
 	glBindTexture(GL_TEXTURE_2D, tex);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, bmp->w, bmp->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, bmp->pix);
 
 	if (!legacy)
 	{
@@ -5774,11 +6688,34 @@ void tigrGAPIDraw(int legacy, GLuint uniform_model, GLuint tex, Tigr *bmp, int x
 	}
 }
 
+// Updates with nothing to present skip the draw and the buffer swap, but the
+// window is still redrawn every so often in case the system lost its contents.
+#define TIGR_IDLE_PRESENT 30
+
+int tigrGAPINeedsPresent(Tigr *bmp, int w, int h)
+{
+	TigrInternal *win = tigrInternal(bmp);
+	GLStuff *gl = &win->gl;
+
+	if (!win->damageTracked || win->widgetsScale > 0 || gl->gl_user_opengl_rendering)
+		return 1;
+	if (win->damage[0] < win->damage[2] && win->damage[1] < win->damage[3])
+		return 1;
+	if (gl->presentW != w || gl->presentH != h || gl->texW[0] != bmp->w || gl->texH[0] != bmp->h)
+		return 1;
+	return ++gl->idleUpdates >= TIGR_IDLE_PRESENT;
+}
+
 void tigrGAPIPresent(Tigr *bmp, int w, int h)
 {
 	TigrInternal *win = tigrInternal(bmp);
 	GLStuff *gl = &win->gl;
 
+	gl->presentW = w;
+	gl->presentH = h;
+	gl->idleUpdates = 0;
+	tigrPresented(win);
+
 	glViewport(0, 0, w, h);
 	if (!gl->gl_user_opengl_rendering)
 	{
@@ -5822,12 +6759,14 @@ void tigrGAPIPresent(Tigr *bmp, int w, int h)
 	{
 		glDisable(GL_BLEND);
 	}
+	tigrGAPIUpload(gl->tex[0], &gl->texW[0], &gl->texH[0], bmp, win->damageTracked ? win->damage : NULL);
 	tigrGAPIDraw(gl->gl_legacy, gl->uniform_model, gl->tex[0], bmp, win->pos[0], win->pos[1], win->pos[2], win->pos[3]);
 
 	if (win->widgetsScale > 0)
 	{
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		tigrGAPIUpload(gl->tex[1], &gl->texW[1], &gl->texH[1], win->widgets, NULL);
 		tigrGAPIDraw(gl->gl_legacy, gl->uniform_model, gl->tex[1], win->widgets,
 					 (int)(w - win->widgets->w * win->widgetsScale), 0,
 					 w, (int)(win->widgets->h * win->widgetsScale));
@@ -5836,6 +6775,9 @@ void tigrGAPIPresent(Tigr *bmp, int w, int h)
 	tigrCheckGLError("present");
 
 	gl->gl_user_opengl_rendering = 0;
+
+	// The texture now matches the bitmap.
+	win->damage[0] = win->damage[1] = win->damage[2] = win->damage[3] = 0;
 }
 
 #endif
@@ -5847,6 +6789,7 @@ void tigrGAPIPresent(Tigr *bmp, int w, int h)
 // #include "tigr_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <chrono>
 
 #ifndef __ANDROID__
 
@@ -5982,6 +6925,7 @@ int tigrBeginOpenGL(Tigr *bmp)
 	win->gl.gl_user_opengl_rendering = 1;
 	return tigrGAPIBegin(bmp) == 0;
 #else
+	(void)bmp;
 	return 0;
 #endif
 }
@@ -5992,6 +6936,10 @@ void tigrSetPostShader(Tigr *bmp, const char *code, int size)
 	TigrInternal *win = tigrInternal(bmp);
 	GLStuff *gl = &win->gl;
 	tigrCreateShaderProgram(gl, code, size);
+#else
+	(void)bmp;
+	(void)code;
+	(void)size;
 #endif
 }
 
@@ -6004,6 +6952,159 @@ void tigrSetPostFX(Tigr *bmp, float p1, float p2, float p3, float p4)
 	win->p4 = p4;
 }
 
+void tigrDamage(Tigr *bmp, int x, int y, int w, int h)
+{
+	TigrInternal *win;
+	int x0, y0, x1, y1;
+
+	if (!bmp->handle)
+		return;
+	win = tigrInternal(bmp);
+
+	// Clip to the bitmap.
+	x0 = x < 0 ? 0 : x;
+	y0 = y < 0 ? 0 : y;
+	x1 = x + w > bmp->w ? bmp->w : x + w;
+	y1 = y + h > bmp->h ? bmp->h : y + h;
+
+	if (!win->damageTracked)
+	{
+		// Nothing was tracked before this call, so the whole texture may be stale.
+		win->damageTracked = 1;
+		win->damage[0] = 0;
+		win->damage[1] = 0;
+		win->damage[2] = bmp->w;
+		win->damage[3] = bmp->h;
+		return;
+	}
+
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	if (win->damage[0] >= win->damage[2] || win->damage[1] >= win->damage[3])
+	{
+		win->damage[0] = x0;
+		win->damage[1] = y0;
+		win->damage[2] = x1;
+		win->damage[3] = y1;
+		return;
+	}
+
+	if (x0 < win->damage[0])
+		win->damage[0] = x0;
+	if (y0 < win->damage[1])
+		win->damage[1] = y0;
+	if (x1 > win->damage[2])
+		win->damage[2] = x1;
+	if (y1 > win->damage[3])
+		win->damage[3] = y1;
+}
+
+void tigrKeyboardState(Tigr *bmp, uint32_t held[8], uint32_t previous[8])
+{
+	TigrInternal *win = tigrInternal(bmp);
+	int i, j;
+
+	for (i = 0; i < 8; i++)
+	{
+		held[i] = previous[i] = 0;
+	}
+#ifdef _WIN32
+	if (GetFocus() != bmp->handle)
+		return;
+#endif
+
+	for (i = 0; i < 8; i++)
+	{
+		for (j = 0; j < 32; j++)
+		{
+			held[i] |= (win->keys[i * 32 + j] ? 1u : 0u) << j;
+			previous[i] |= (win->prev[i * 32 + j] ? 1u : 0u) << j;
+		}
+	}
+}
+
+double tigrEventTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void tigrQueueEvent(TigrInternal *win, TigrEventQueue *queue, TigrEventType type, int x, int y, int button, double time)
+{
+	TigrEvent *event;
+
+	if (queue->head - queue->tail == TIGR_EVENT_QUEUE)
+		queue->tail++;
+
+	event = &queue->events[queue->head % TIGR_EVENT_QUEUE];
+	event->type = type;
+	event->x = x;
+	event->y = y;
+	event->button = button;
+	event->time = time;
+	queue->head++;
+
+	if (win->inputPending == 0)
+		win->inputPending = time;
+}
+
+static int tigrPopEvent(TigrEventQueue *queue, TigrEvent *event)
+{
+	if (queue->head == queue->tail)
+		return 0;
+	*event = queue->events[queue->tail % TIGR_EVENT_QUEUE];
+	queue->tail++;
+	return 1;
+}
+
+int tigrPopMouseEvent(Tigr *bmp, TigrEvent *event)
+{
+	return tigrPopEvent(&tigrInternal(bmp)->mouseEvents, event);
+}
+
+int tigrPopKeyEvent(Tigr *bmp, TigrEvent *event)
+{
+	return tigrPopEvent(&tigrInternal(bmp)->keyEvents, event);
+}
+
+void tigrQueueChanges(Tigr *bmp)
+{
+	TigrInternal *win = tigrInternal(bmp);
+	int x, y, buttons, changed, button, key;
+	double time = tigrEventTime();
+
+	tigrMouse(bmp, &x, &y, &buttons);
+	changed = buttons ^ win->queuedButtons;
+	for (button = 1; button <= 4; button <<= 1)
+	{
+		if (changed & button)
+			tigrQueueEvent(win, &win->mouseEvents, (buttons & button) ? TIGR_MOUSE_DOWN : TIGR_MOUSE_UP, x, y, button, time);
+	}
+	win->queuedButtons = buttons;
+
+	for (key = 0; key < 256; key++)
+	{
+		if ((win->keys[key] != 0) != (win->queuedKeys[key] != 0))
+		{
+			win->queuedKeys[key] = win->keys[key];
+			tigrQueueEvent(win, &win->keyEvents, win->keys[key] ? TIGR_KEY_DOWN : TIGR_KEY_UP, 0, 0, key, time);
+		}
+	}
+}
+
+void tigrPresented(TigrInternal *win)
+{
+	if (win->inputPending == 0)
+		return;
+	win->inputLatency = tigrEventTime() - win->inputPending;
+	win->inputPending = 0;
+}
+
+double tigrInputLatency(Tigr *bmp)
+{
+	return tigrInternal(bmp)->inputLatency;
+}
+
 //////// End of inlined file: tigr_utils.c ////////
 
 //////// End of inlined file: tigr_amalgamated.c ////////
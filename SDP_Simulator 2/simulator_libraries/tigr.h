@@ -87,6 +87,11 @@ void tigrSetPostShader(Tigr *bmp, const char* code, int size);
 // p4: contrast - contrast boost (1 = no change, 2 = 2X contrast, etc)
 void tigrSetPostFX(Tigr *bmp, float p1, float p2, float p3, float p4);
 
+// Marks part of a window as changed since the last tigrUpdate.
+// Once this has been called for a window, tigrUpdate only uploads the
+// marked area to the GPU, and skips the upload when nothing was marked.
+void tigrDamage(Tigr *bmp, int x, int y, int w, int h);
+
 
 // Drawing ----------------------------------------------------------------
 
@@ -205,6 +210,64 @@ int tigrReadChar(Tigr *bmp);
 /// Custom function, returns all 256 keys in a single uint32_t
 std::vector<uint32_t> tigrKeyboardData(Tigr *bmp);
 
+// Reads every key as 8 32-bit masks (bit k of held[k / 32] is key k), for
+// this update and the one before, without allocating.
+void tigrKeyboardState(Tigr *bmp, uint32_t held[8], uint32_t previous[8]);
+
+// Input events -----------------------------------------------------------
+//
+// Mouse button and key presses and releases are queued with the time they
+// happened, so a click that starts and ends between two tigrUpdate calls is
+// not lost. X11 queues the window system's events as they arrive; the other
+// backends queue what changed since the previous tigrUpdate.
+// Each queue keeps the latest TIGR_EVENT_QUEUE events.
+
+#define TIGR_EVENT_QUEUE 64
+
+typedef enum {
+    TIGR_MOUSE_DOWN, TIGR_MOUSE_UP, TIGR_KEY_DOWN, TIGR_KEY_UP
+} TigrEventType;
+
+typedef struct {
+    TigrEventType type;
+    int x, y;       // Mouse position in bitmap pixels, for mouse events
+    int button;     // Mouse button (1, 2 or 4, as in tigrMouse) or key (TKey or ASCII)
+    double time;    // Seconds, on the tigrEventTime clock
+} TigrEvent;
+
+// Takes the oldest queued mouse or key event. Returns 0 when there is none.
+int tigrPopMouseEvent(Tigr *bmp, TigrEvent *event);
+int tigrPopKeyEvent(Tigr *bmp, TigrEvent *event);
+
+// Returns the time events are stamped with, in seconds.
+double tigrEventTime();
+
+// Returns the seconds from the first input after a present to the present
+// that followed it, for the latest such pair, or 0 if there was none yet.
+double tigrInputLatency(Tigr *bmp);
+
+#ifdef TIGR_HEADLESS
+// Headless windows -------------------------------------------------------
+//
+// Built with TIGR_HEADLESS, tigrWindow returns an off-screen bitmap and
+// never opens a display. tigrUpdate does not wait for anything, it just
+// advances the frame counter and asks the input script for this frame's input.
+
+// Called at the start of every tigrUpdate with the number of the frame
+// being finished (0 for the first). It sets input with the functions below.
+typedef void (*TigrInputScript)(Tigr *bmp, int frame, void *userData);
+void tigrHeadlessScript(Tigr *bmp, TigrInputScript script, void *userData);
+
+// Sets the input a headless window reports. It stays until it is changed.
+void tigrHeadlessMouse(Tigr *bmp, int x, int y, int buttons);
+void tigrHeadlessKey(Tigr *bmp, int key, int down);
+void tigrHeadlessChar(Tigr *bmp, int cp);
+void tigrHeadlessClose(Tigr *bmp);
+
+// Returns the number of tigrUpdate calls so far.
+int tigrHeadlessFrame(Tigr *bmp);
+#endif // TIGR_HEADLESS
+
 // Bitmap I/O -------------------------------------------------------------
 
 // Loads a PNG, from either a file or memory. (fileName is UTF-8)
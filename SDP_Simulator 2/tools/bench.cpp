@@ -0,0 +1,442 @@
+#include "core/blackjack.h"
+#include "core/shoe.h"
+#include "core/handbatch.h"
+#include "core/simulation.h"
+#include "FEHRandom.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define bench_min_seconds 0.2
+#define bench_quick_seconds 0.02
+#define bench_repeats 3
+#define bench_sim_rounds 4000000
+#define bench_quick_sim_rounds 400000
+
+/*
+ Game core benchmarks
+
+ Times the hot parts of the game core one at a time (Hand, DealCard, the dealer,
+ DetermineWinner, whole rounds) and then the multi-threaded simulator at 1 to N
+ threads. Prints a table, and with --json writes the same numbers as JSON so runs
+ from different commits can be compared by a script.
+ Built with "make bench", it does not link tigr, X11 or OpenGL.
+
+ Usage: bench.out [--threads N] [--quick] [--json file] [--label text]
+   --threads N: Highest thread count for the simulator scaling test (default: every core)
+   --quick: Shorter runs, for a smoke test
+   --json file: Also write the results as JSON to file ("-" for standard output,
+               which moves the table to standard error)
+   --label text: Name for this run in the JSON, e.g. a commit hash
+
+ Author: Kerem Cakmak
+ */
+
+// results are added here so the compiler cannot throw the benchmarked work away
+volatile long long bench_sink;
+
+/*
+ BenchResult Struct
+
+ One timed benchmark.
+
+ Members:
+   - name: Benchmark name
+   - ops: Operations timed in the best run
+   - seconds: Time of the best run
+   - threads: Threads used (simulator only, 1 otherwise)
+   - speedup, efficiency: Against the 1 thread simulator run (simulator only)
+
+ Author: Kerem Cakmak
+ */
+struct BenchResult {
+    std::string name;
+    long long ops;
+    double seconds;
+    int threads;
+    double speedup;
+    double efficiency;
+};
+
+typedef long long (*BenchFunction)(long long iterations);
+
+// returns seconds since some fixed point
+static double Now() {
+    std::chrono::duration<double> t = std::chrono::steady_clock::now().time_since_epoch();
+    return t.count();
+}
+
+// adds 8 cards to a hand at a time and reads the value after every card
+static long long BenchHandAddCard(long long iterations) {
+    Hand hand;
+    long long sum = 0;
+    long long i = 0;
+    while(i < iterations) {
+        if((i & 7) == 0) {
+            hand.Clear();
+        }
+        hand.AddCard(2 + (int)(i % 9));
+        sum = sum + hand.GetValue();
+        i = i + 1;
+    }
+    bench_sink = sum;
+    return iterations;
+}
+
+// deals single cards from the calling thread's stream
+static long long BenchDealCard(long long iterations) {
+    long long sum = 0;
+    long long i = 0;
+    while(i < iterations) {
+        sum = sum + DealCard();
+        i = i + 1;
+    }
+    bench_sink = sum;
+    return iterations;
+}
+
+// deals cards 4096 at a time
+static long long BenchDealCards(long long iterations) {
+    std::vector<int> cards(4096);
+    long long sum = 0;
+    long long done = 0;
+    while(done < iterations) {
+        DealCards(cards.data(), (int)cards.size());
+        sum = sum + cards[0];
+        done = done + (long long)cards.size();
+    }
+    bench_sink = sum;
+    return done;
+}
+
+// deals a dealer two cards and plays the hand out with the rule of 17
+static long long BenchDealerPlayOut(long long iterations) {
+    Dealer dealer;
+    long long sum = 0;
+    long long i = 0;
+    while(i < iterations) {
+        dealer.Reset();
+        dealer.GetHand()->AddCard(DealCard());
+        dealer.GetHand()->AddCard(DealCard());
+        while(dealer.ShouldHit() == true && dealer.GetHand()->GetCount() < max_cards) {
+            dealer.GetHand()->AddCard(DealCard());
+        }
+        sum = sum + dealer.GetHand()->GetValue();
+        i = i + 1;
+    }
+    bench_sink = sum;
+    return iterations;
+}
+
+// decides pairs of values that were made before the timer started
+static long long BenchDetermineWinner(long long iterations) {
+    static std::vector<int> values;
+    if(values.empty() == true) {
+        values.resize(8192);
+        int i = 0;
+        while(i < (int)values.size()) {
+            values[i] = Random.RandRange(12, 26);
+            i = i + 1;
+        }
+    }
+    int mask = (int)values.size() - 1;
+    long long sum = 0;
+    long long i = 0;
+    while(i < iterations) {
+        int index = (int)(i & mask);
+        sum = sum + DetermineWinner(values[index], values[(index + 1) & mask]);
+        i = i + 1;
+    }
+    bench_sink = sum;
+    return iterations;
+}
+
+// plays whole rounds from the infinite deck
+static long long BenchRound(long long iterations) {
+    Player player(0);
+    Dealer dealer;
+    long long sum = 0;
+    long long i = 0;
+    while(i < iterations) {
+        sum = sum + PlayRound(&player, &dealer, 17, NULL);
+        i = i + 1;
+    }
+    bench_sink = sum;
+    return iterations;
+}
+
+// plays whole rounds from a 6 deck shoe, shuffles included
+static long long BenchRoundShoe(long long iterations) {
+    static Shoe shoe(6, 0.75, shoe_reshuffle_at_cut);
+    Player player(0);
+    Dealer dealer;
+    long long sum = 0;
+    long long i = 0;
+    while(i < iterations) {
+        sum = sum + PlayRound(&player, &dealer, 17, &shoe);
+        i = i + 1;
+    }
+    bench_sink = sum;
+    return iterations;
+}
+
+// plays dealer hands out 4096 at a time with the SIMD kernels, cards dealt beforehand
+static long long BenchBatchPlayOut(long long iterations) {
+    static HandBatch batch(4096);
+    static std::vector<unsigned char> cards;
+    int lanes = batch.GetLanes();
+    if(cards.empty() == true) {
+        cards.resize(lanes * max_cards);
+        Random.Stream().Fill(cards.data(), (int)cards.size(), 2, 10);
+    }
+    long long sum = 0;
+    long long done = 0;
+    while(done < iterations) {
+        batch.Clear();
+        batch.AddCards(&cards[0]);
+        batch.AddCards(&cards[lanes]);
+        PlayOutBatch(&batch, &cards[2 * lanes], max_cards - 2, dealer_stand_value);
+        sum = sum + batch.GetTotals()[0];
+        done = done + batch.GetSize();
+    }
+    bench_sink = sum;
+    return done;
+}
+
+/*
+ RunBenchmark Function
+
+ This function doubles the number of iterations until one run takes at least
+ minSeconds, then times bench_repeats runs of that size and keeps the fastest,
+ which is the least disturbed by other programs.
+
+ Input Arguments:
+   - name: Benchmark name
+   - function: Benchmark to run
+   - minSeconds: Shortest run worth timing
+
+ Return Value: BenchResult of the fastest run
+
+ Author: Kerem Cakmak
+ */
+static BenchResult RunBenchmark(const char *name, BenchFunction function, double minSeconds) {
+    Random.Seed(1);
+    long long iterations = 1024;
+    while(true) {
+        double start = Now();
+        function(iterations);
+        if(Now() - start >= minSeconds || iterations >= (1LL << 40)) {
+            break;
+        }
+        iterations = iterations * 2;
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.ops = 0;
+    result.seconds = 0.0;
+    result.threads = 1;
+    result.speedup = 1.0;
+    result.efficiency = 1.0;
+
+    int repeat = 0;
+    while(repeat < bench_repeats) {
+        double start = Now();
+        long long ops = function(iterations);
+        double seconds = Now() - start;
+        if(repeat == 0 || seconds / ops < result.seconds / result.ops) {
+            result.ops = ops;
+            result.seconds = seconds;
+        }
+        repeat = repeat + 1;
+    }
+    return result;
+}
+
+// returns operations per second
+static double Throughput(BenchResult result) {
+    if(result.seconds <= 0.0) {
+        return 0.0;
+    }
+    return result.ops / result.seconds;
+}
+
+// returns nanoseconds per operation (per round for the simulator, counting all threads together)
+static double NsPerOp(BenchResult result) {
+    if(result.ops <= 0) {
+        return 0.0;
+    }
+    return result.seconds * 1e9 / result.ops;
+}
+
+// writes text as a quoted JSON string
+static void WriteJsonString(FILE *file, const char *text) {
+    fputc('"', file);
+    while(*text != '\0') {
+        if(*text == '"' || *text == '\\') {
+            fputc('\\', file);
+        }
+        if((unsigned char)*text >= ' ') {
+            fputc(*text, file);
+        }
+        text = text + 1;
+    }
+    fputc('"', file);
+}
+
+/*
+ WriteJson Function
+
+ This function writes every result as one JSON object.
+
+ Input Arguments:
+   - file: Where to write
+   - label: Name of this run
+   - results: Benchmark results
+
+ Return Value: None (void)
+
+ Author: Kerem Cakmak
+ */
+static void WriteJson(FILE *file, const char *label, std::vector<BenchResult> &results) {
+    fprintf(file, "{\n");
+    fprintf(file, "  \"label\": ");
+    WriteJsonString(file, label);
+    fprintf(file, ",\n");
+#ifdef __VERSION__
+    fprintf(file, "  \"compiler\": ");
+    WriteJsonString(file, __VERSION__);
+    fprintf(file, ",\n");
+#endif
+    fprintf(file, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(file, "  \"simd\": \"%s\",\n", BatchSimdName(BatchSimdLevel()));
+    fprintf(file, "  \"benchmarks\": [\n");
+    int i = 0;
+    while(i < (int)results.size()) {
+        BenchResult r = results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"threads\": %d, \"ops\": %lld, \"seconds\": %.6f, "
+            "\"ops_per_sec\": %.1f, \"ns_per_op\": %.3f, \"speedup\": %.3f, \"efficiency\": %.3f}",
+            r.name.c_str(), r.threads, r.ops, r.seconds, Throughput(r), NsPerOp(r), r.speedup, r.efficiency);
+        if(i + 1 < (int)results.size()) {
+            fprintf(file, ",");
+        }
+        fprintf(file, "\n");
+        i = i + 1;
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+}
+
+int main(int argc, char *argv[]) {
+    int maxThreads = (int)std::thread::hardware_concurrency();
+    bool quick = false;
+    const char *jsonPath = NULL;
+    const char *label = "";
+
+    int arg = 1;
+    while(arg < argc) {
+        if(strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+            maxThreads = atoi(argv[arg + 1]);
+            arg = arg + 1;
+        } else if(strcmp(argv[arg], "--quick") == 0) {
+            quick = true;
+        } else if(strcmp(argv[arg], "--json") == 0 && arg + 1 < argc) {
+            jsonPath = argv[arg + 1];
+            arg = arg + 1;
+        } else if(strcmp(argv[arg], "--label") == 0 && arg + 1 < argc) {
+            label = argv[arg + 1];
+            arg = arg + 1;
+        } else {
+            printf("Usage: %s [--threads N] [--quick] [--json file] [--label text]\n", argv[0]);
+            return 1;
+        }
+        arg = arg + 1;
+    }
+    if(maxThreads <= 0) {
+        maxThreads = 1;
+    }
+
+    double minSeconds = bench_min_seconds;
+    long long simRounds = bench_sim_rounds;
+    if(quick == true) {
+        minSeconds = bench_quick_seconds;
+        simRounds = bench_quick_sim_rounds;
+    }
+
+    std::vector<BenchResult> results;
+    results.push_back(RunBenchmark("hand_add_card", BenchHandAddCard, minSeconds));
+    results.push_back(RunBenchmark("deal_card", BenchDealCard, minSeconds));
+    results.push_back(RunBenchmark("deal_cards_4096", BenchDealCards, minSeconds));
+    results.push_back(RunBenchmark("dealer_play_out", BenchDealerPlayOut, minSeconds));
+    results.push_back(RunBenchmark("batch_dealer_play_out", BenchBatchPlayOut, minSeconds));
+    results.push_back(RunBenchmark("determine_winner", BenchDetermineWinner, minSeconds));
+    results.push_back(RunBenchmark("round_infinite_deck", BenchRound, minSeconds));
+    results.push_back(RunBenchmark("round_6_deck_shoe", BenchRoundShoe, minSeconds));
+
+    // simulator scaling, same rounds and seed for every thread count
+    double singleRate = 0.0;
+    int threads = 1;
+    while(threads <= maxThreads) {
+        SimulationConfig config = DefaultSimulationConfig();
+        config.rounds = simRounds;
+        config.threads = threads;
+
+        BenchResult result;
+        result.name = "simulation";
+        result.threads = threads;
+        result.ops = 0;
+        result.seconds = 0.0;
+        int repeat = 0;
+        while(repeat < bench_repeats) {
+            SimulationStats stats = RunSimulation(config);
+            if(repeat == 0 || stats.seconds < result.seconds) {
+                result.ops = stats.rounds;
+                result.seconds = stats.seconds;
+            }
+            repeat = repeat + 1;
+        }
+        if(threads == 1) {
+            singleRate = Throughput(result);
+        }
+        result.speedup = 0.0;
+        if(singleRate > 0.0) {
+            result.speedup = Throughput(result) / singleRate;
+        }
+        result.efficiency = result.speedup / threads;
+        results.push_back(result);
+        threads = threads + 1;
+    }
+
+    // the table goes to stderr when stdout carries the JSON, so stdout stays parseable
+    FILE *table = stdout;
+    if(jsonPath != NULL && strcmp(jsonPath, "-") == 0) {
+        table = stderr;
+    }
+    fprintf(table, "%-24s %7s %14s %12s %8s %10s\n", "Benchmark", "Threads", "Ops/sec", "ns/op", "Speedup", "Efficiency");
+    int i = 0;
+    while(i < (int)results.size()) {
+        BenchResult r = results[i];
+        fprintf(table, "%-24s %7d %14.0f %12.2f %8.2f %9.0f%%\n", r.name.c_str(), r.threads, Throughput(r), NsPerOp(r), r.speedup, 100.0 * r.efficiency);
+        i = i + 1;
+    }
+
+    if(jsonPath != NULL) {
+        if(strcmp(jsonPath, "-") == 0) {
+            WriteJson(stdout, label, results);
+        } else {
+            FILE *file = fopen(jsonPath, "w");
+            if(file == NULL) {
+                printf("Could not write %s\n", jsonPath);
+                return 1;
+            }
+            WriteJson(file, label, results);
+            fclose(file);
+        }
+    }
+
+    return 0;
+}
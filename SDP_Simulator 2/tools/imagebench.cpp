@@ -0,0 +1,202 @@
+#include "tigr.h"
+#include <algorithm>
+#include <chrono>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define imagebench_min_seconds 0.2
+#define imagebench_quick_seconds 0.02
+#define imagebench_repeats 3
+
+/*
+ ImageBenchResult Struct
+
+ Decode speed of one PNG file.
+
+ Members:
+   - name: File name
+   - fileBytes: Size of the PNG file
+   - pixelBytes: Size of the decoded RGBA bitmap
+   - decodes: Decodes timed in the best run
+   - seconds: Time of the best run
+
+ Author: Kerem Cakmak
+ */
+struct ImageBenchResult {
+    std::string name;
+    long long fileBytes;
+    long long pixelBytes;
+    long long decodes;
+    double seconds;
+};
+
+// returns seconds since some fixed point
+static double Now() {
+    std::chrono::duration<double> t = std::chrono::steady_clock::now().time_since_epoch();
+    return t.count();
+}
+
+// returns true if name ends in .png or .PNG
+static bool IsPng(const char *name) {
+    size_t length = strlen(name);
+    if(length < 4) {
+        return false;
+    }
+    return strcmp(name + length - 4, ".png") == 0 || strcmp(name + length - 4, ".PNG") == 0;
+}
+
+// decodes a PNG already in memory count times, returns false if it does not decode
+static bool DecodeTimes(const void *data, int length, long long count) {
+    long long i = 0;
+    while(i < count) {
+        Tigr *bmp = tigrLoadImageMem(data, length);
+        if(bmp == NULL) {
+            return false;
+        }
+        tigrFree(bmp);
+        i = i + 1;
+    }
+    return true;
+}
+
+/*
+ BenchImage Function
+
+ This function times decoding one PNG from memory (so disk speed is not counted),
+ doubling the decode count until a run takes minSeconds, then keeps the fastest
+ of imagebench_repeats runs.
+
+ Input Arguments:
+   - name: PNG file to decode
+   - minSeconds: Shortest run to time
+   - result: Filled in with the timing
+
+ Return Value: true if the file was read and decoded
+
+ Author: Kerem Cakmak
+ */
+static bool BenchImage(const char *name, double minSeconds, ImageBenchResult *result) {
+    int length = 0;
+    void *data = tigrReadFile(name, &length);
+    if(data == NULL) {
+        printf("Could not read %s\n", name);
+        return false;
+    }
+
+    Tigr *bmp = tigrLoadImageMem(data, length);
+    if(bmp == NULL) {
+        printf("Could not decode %s\n", name);
+        free(data);
+        return false;
+    }
+    result->name = name;
+    result->fileBytes = length;
+    result->pixelBytes = (long long)bmp->w * bmp->h * sizeof(TPixel);
+    tigrFree(bmp);
+
+    long long count = 1;
+    while(true) {
+        double start = Now();
+        DecodeTimes(data, length, count);
+        if(Now() - start >= minSeconds) {
+            break;
+        }
+        count = count * 2;
+    }
+
+    int repeat = 0;
+    while(repeat < imagebench_repeats) {
+        double start = Now();
+        DecodeTimes(data, length, count);
+        double seconds = Now() - start;
+        if(repeat == 0 || seconds < result->seconds) {
+            result->decodes = count;
+            result->seconds = seconds;
+        }
+        repeat = repeat + 1;
+    }
+
+    free(data);
+    return true;
+}
+
+/*
+ PNG decode benchmark
+
+ Times tigrLoadImageMem on PNG files and prints decode throughput in MB/s, of
+ decoded RGBA pixels and of compressed file bytes, per file and for all of them.
+ With no file names, every .png in the current directory is timed, so run it from
+ the project folder to time the game's images.
+ Built with "make imagebench", it links tigr without a window (TIGR_HEADLESS).
+
+ Usage: imagebench.out [--quick] [images...]
+   --quick: Shorter runs, for a smoke test
+
+ Author: Kerem Cakmak
+ */
+int main(int argc, char *argv[]) {
+    bool quick = false;
+    std::vector<std::string> images;
+
+    int arg = 1;
+    while(arg < argc) {
+        if(strcmp(argv[arg], "--quick") == 0) {
+            quick = true;
+        } else {
+            images.push_back(argv[arg]);
+        }
+        arg = arg + 1;
+    }
+
+    if(images.empty() == true) {
+        DIR *dir = opendir(".");
+        if(dir != NULL) {
+            struct dirent *file = readdir(dir);
+            while(file != NULL) {
+                if(IsPng(file->d_name) == true) {
+                    images.push_back(file->d_name);
+                }
+                file = readdir(dir);
+            }
+            closedir(dir);
+        }
+        std::sort(images.begin(), images.end());
+    }
+    if(images.empty() == true) {
+        printf("Usage: %s [--quick] [images...]\n", argv[0]);
+        return 1;
+    }
+
+    double minSeconds = imagebench_min_seconds;
+    if(quick == true) {
+        minSeconds = imagebench_quick_seconds;
+    }
+
+    printf("%-24s %10s %10s %12s %12s %12s\n", "Image", "File KB", "Pixel KB", "ms/decode", "Pixel MB/s", "File MB/s");
+    double totalSeconds = 0.0;
+    long long totalFile = 0;
+    long long totalPixels = 0;
+    int i = 0;
+    while(i < (int)images.size()) {
+        ImageBenchResult r;
+        if(BenchImage(images[i].c_str(), minSeconds, &r) == true) {
+            double seconds = r.seconds / r.decodes;
+            printf("%-24s %10.1f %10.1f %12.3f %12.1f %12.1f\n", r.name.c_str(), r.fileBytes / 1024.0, r.pixelBytes / 1024.0,
+                   seconds * 1000.0, r.pixelBytes / seconds / 1e6, r.fileBytes / seconds / 1e6);
+            totalSeconds = totalSeconds + seconds;
+            totalFile = totalFile + r.fileBytes;
+            totalPixels = totalPixels + r.pixelBytes;
+        }
+        i = i + 1;
+    }
+
+    if(totalSeconds > 0.0) {
+        printf("%-24s %10.1f %10.1f %12.3f %12.1f %12.1f\n", "All", totalFile / 1024.0, totalPixels / 1024.0,
+               totalSeconds * 1000.0, totalPixels / totalSeconds / 1e6, totalFile / totalSeconds / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "FEHImages.h"
+#include <algorithm>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// returns true if name ends in .png or .PNG
+bool IsPng(const char *name) {
+    size_t length = strlen(name);
+    if(length < 4) {
+        return false;
+    }
+    return strcmp(name + length - 4, ".png") == 0 || strcmp(name + length - 4, ".PNG") == 0;
+}
+
+/*
+ Asset packer
+
+ Decodes images once and writes them to one asset pack, with the run tables
+ FEHImage::Draw uses, so the game can map the pack with FEHImage::OpenPack
+ instead of opening and inflating every PNG at startup.
+ With no image names, every .png in the current directory is packed.
+ "make pack" builds this tool and packs the game's images into assets.pack.
+ Rerun it after changing an image (until then, the changed file is loaded instead).
+
+ Usage: pack.out <pack file> [images...]
+
+ Author: Kerem Cakmak
+ */
+int main(int argc, char *argv[]) {
+    if(argc < 2) {
+        printf("Usage: %s <pack file> [images...]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<std::string> images;
+    int arg = 2;
+    while(arg < argc) {
+        images.push_back(argv[arg]);
+        arg = arg + 1;
+    }
+
+    if(images.empty() == true) {
+        DIR *dir = opendir(".");
+        if(dir != NULL) {
+            struct dirent *file = readdir(dir);
+            while(file != NULL) {
+                if(IsPng(file->d_name) == true) {
+                    images.push_back(file->d_name);
+                }
+                file = readdir(dir);
+            }
+            closedir(dir);
+        }
+        // same pack every time for the same images
+        std::sort(images.begin(), images.end());
+    }
+
+    if(FEHImage::WritePack(argv[1], images) == false) {
+        return 1;
+    }
+
+    printf("Packed %d images into %s\n", (int)images.size(), argv[1]);
+    return 0;
+}
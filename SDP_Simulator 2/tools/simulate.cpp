@@ -0,0 +1,103 @@
+#include "core/blackjack.h"
+#include "core/simulation.h"
+#include "core/handbatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ Headless blackjack simulator
+
+ Plays rounds with the same rules as PlayBlackjack, without opening a window,
+ and reports the house edge for the current win_reward and loss_penalty.
+ Built with "make simulate", it does not link tigr, X11 or OpenGL.
+
+ Decks of 0 (the default) deal from an infinite deck like DealCard.
+ A batch size above 0 plays that many rounds at once with the SIMD HandBatch kernels.
+ The last four arguments change the rules, which must match one of the rule sets
+ compiled in core/rules.cpp (the list is printed if they do not).
+
+ Usage: simulate.out [rounds] [threads] [player stand value] [seed] [decks] [penetration] [batch size]
+                     [dealer stand value] [win reward] [loss penalty] [lowest card]
+
+ Author: Kerem Cakmak
+ */
+int main(int argc, char *argv[]) {
+    SimulationConfig config = DefaultSimulationConfig();
+
+    if(argc > 1) {
+        config.rounds = atoll(argv[1]);
+    }
+    if(argc > 2) {
+        config.threads = atoi(argv[2]);
+    }
+    if(argc > 3) {
+        config.playerStandValue = atoi(argv[3]);
+    }
+    if(argc > 4) {
+        config.seed = strtoull(argv[4], NULL, 10);
+    }
+    if(argc > 5) {
+        config.rules.decks = atoi(argv[5]);
+    }
+    if(argc > 6) {
+        config.penetration = atof(argv[6]);
+    }
+    if(argc > 7) {
+        config.batchSize = atoi(argv[7]);
+    }
+    if(argc > 8) {
+        config.rules.dealerStand = atoi(argv[8]);
+    }
+    if(argc > 9) {
+        config.rules.winReward = atoi(argv[9]);
+    }
+    if(argc > 10) {
+        config.rules.lossPenalty = atoi(argv[10]);
+    }
+    if(argc > 11) {
+        config.rules.minCard = atoi(argv[11]);
+    }
+
+    if(config.rounds <= 0) {
+        printf("Usage: %s [rounds] [threads] [player stand value] [seed] [decks] [penetration] [batch size]\n", argv[0]);
+        printf("       [dealer stand value] [win reward] [loss penalty] [lowest card]\n");
+        return 1;
+    }
+
+    if(FindRuleVariant(config.rules) == NULL) {
+        printf("No compiled rule set matches these rules. Compiled rule sets:\n");
+        printf("  dealer stands  bust  win  loss  cards  decks\n");
+        int i = 0;
+        while(i < RuleVariantCount()) {
+            RuleConfig rules = RuleVariantAt(i);
+            printf("  %13d  %4d  %3d  %4d  %2d-%-2d  %5d\n", rules.dealerStand, rules.bustLimit, rules.winReward, rules.lossPenalty, rules.minCard, rules.maxCard, rules.decks);
+            i = i + 1;
+        }
+        return 1;
+    }
+
+    SimulationStats stats = RunSimulation(config);
+
+    printf("Rounds:        %lld\n", stats.rounds);
+    printf("Threads:       %d\n", stats.threads);
+    printf("Stand on:      %d\n", config.playerStandValue);
+    printf("Seed:          %llu\n", config.seed);
+    printf("Rules:         dealer stands on %d, win +%d / loss -%d, cards %d-%d\n", config.rules.dealerStand, config.rules.winReward, config.rules.lossPenalty, config.rules.minCard, config.rules.maxCard);
+    if(config.rules.decks > 0) {
+        printf("Shoe:          %d decks, %.0f%% penetration\n", config.rules.decks, 100.0 * config.penetration);
+    } else {
+        printf("Shoe:          infinite deck\n");
+    }
+    if(config.batchSize > 0 && SameRules(config.rules, StandardRuleConfig()) == true) {
+        printf("Batch:         %d hands (%s)\n", config.batchSize, BatchSimdName(BatchSimdLevel()));
+    }
+    printf("Wins:          %lld (%.4f%%)\n", stats.wins, 100.0 * stats.wins / stats.rounds);
+    printf("Losses:        %lld (%.4f%%)\n", stats.losses, 100.0 * stats.losses / stats.rounds);
+    printf("Ties:          %lld (%.4f%%)\n", stats.ties, 100.0 * stats.ties / stats.rounds);
+    printf("EV per round:  %+.4f (+/- %.4f)\n", ExpectedValue(stats), StandardError(stats));
+    printf("Variance:      %.4f\n", Variance(stats));
+    printf("Time:          %.3f s\n", stats.seconds);
+    printf("Hands/sec:     %.0f\n", HandsPerSecond(stats));
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "core/strategy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ Basic strategy generator
+
+ Solves Hit vs Stand exactly for every player total and dealer upcard with the
+ rules in core/blackjack.h, and prints the basic strategy table (H = hit, S = stand).
+ With -v the EV of both choices is printed for every cell as well.
+ Built with "make strategy", it does not link tigr, X11 or OpenGL.
+
+ Usage: strategy.out [threads] [-v]
+
+ Author: Kerem Cakmak
+ */
+int main(int argc, char *argv[]) {
+    int threads = 0;
+    bool verbose = false;
+
+    int arg = 1;
+    while(arg < argc) {
+        if(strcmp(argv[arg], "-v") == 0) {
+            verbose = true;
+        } else {
+            threads = atoi(argv[arg]);
+        }
+        arg = arg + 1;
+    }
+
+    StrategyTable table = BuildStrategyTable(threads);
+
+    printf("Basic strategy, infinite deck, win +%d / loss -%d\n\n", win_reward, loss_penalty);
+    printf("Total ");
+    int upcard = min_card;
+    while(upcard <= max_card) {
+        printf("%3d", upcard);
+        upcard = upcard + 1;
+    }
+    printf("\n");
+
+    int total = strategy_min_total;
+    while(total <= blackjack_value) {
+        printf("%5d ", total);
+        upcard = min_card;
+        while(upcard <= max_card) {
+            if(table.action[total][upcard] == action_hit) {
+                printf("  H");
+            } else {
+                printf("  S");
+            }
+            upcard = upcard + 1;
+        }
+        printf("\n");
+        total = total + 1;
+    }
+
+    if(verbose == true) {
+        printf("\nTotal Upcard     Hit EV   Stand EV\n");
+        total = strategy_min_total;
+        while(total <= blackjack_value) {
+            upcard = min_card;
+            while(upcard <= max_card) {
+                printf("%5d %6d %10.4f %10.4f\n", total, upcard, table.hitEV[total][upcard], table.standEV[total][upcard]);
+                upcard = upcard + 1;
+            }
+            total = total + 1;
+        }
+    }
+
+    printf("\nEV per round:  %+.4f\n", table.roundEV);
+    printf("Threads:       %d\n", table.threads);
+    printf("Time:          %.3f ms\n", table.seconds * 1000.0);
+
+    return 0;
+}